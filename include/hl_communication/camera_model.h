@@ -0,0 +1,199 @@
+#pragma once
+
+#include <hl_communication/camera.pb.h>
+
+#include <opencv2/core.hpp>
+#include <Eigen/Geometry>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace hl_communication
+{
+/**
+ * Return the squared radius of the domain in which the distortion can be corrected, in normalized coordinates (x/z,
+ * y/z in the camera basis). It is the smallest positive root of the derivative of the radial distortion
+ * r * (1 + k1 * r^2 + k2 * r^4), infinity if there is none or if p1, p2 or k3 is not 0 (validity is then not checked).
+ *
+ * The domain only depends on the intrinsic parameters, it should be computed once per camera.
+ */
+double getCorrectionRadius2(const IntrinsicParameters& camera_parameters);
+double getCorrectionRadius2(const cv::Mat& distortion_coeffs);
+
+/**
+ * Return true if the normalized position (x/z, y/z) is inside the domain described by 'correction_radius2' (see
+ * getCorrectionRadius2), positions close to the optical axis are always valid
+ */
+bool isNormalizedValidForCorrection(double x, double y, double correction_radius2);
+
+/**
+ * Projection from the field to the image of a camera, all the conversions of the intrinsic and extrinsic parameters
+ * are done once at construction. Results are identical to fieldToImg, which uses a temporary CameraModel.
+ *
+ * Distortion follows the model of OpenCV (k1, k2, p1, p2[, k3[, k4, k5, k6[, s1, s2, s3, s4]]]), the tilted sensor
+ * model (14 coefficients) is not supported.
+ */
+class CameraModel
+{
+public:
+  /**
+   * Throws runtime_error if camera_information is not fully specified or if its content is not supported
+   */
+  CameraModel(const CameraMetaInformation& camera_information);
+  CameraModel(const IntrinsicParameters& camera_parameters, const Pose3D& pose);
+
+  cv::Size getImgSize() const;
+
+  /**
+   * Squared radius of the domain in which points are valid for correction, see getCorrectionRadius2
+   */
+  double getCorrectionRadius2() const;
+
+  /**
+   * Convert a point from the field basis to the camera basis
+   */
+  cv::Point3f fieldToCamera(const cv::Point3f& pos_in_field) const;
+
+  /**
+   * Return false if the point is too far from the optical axis for the distortion model to be monotonic, the projection
+   * is then meaningless. See isPointValidForCorrection
+   */
+  bool isValidForCorrection(const cv::Point3f& pos_in_field) const;
+
+  /**
+   * Store in 'valid' the result of isValidForCorrection for each point
+   */
+  void getValidityMask(const std::vector<cv::Point3f>& pos_in_field, std::vector<uint8_t>* valid) const;
+
+  /**
+   * Image position of the point, throws runtime_error if the point is not valid for correction
+   */
+  cv::Point2f project(const cv::Point3f& pos_in_field) const;
+
+  /**
+   * Write the image position of the point in 'img_pos' and return true if it is valid: valid for correction, in front
+   * of the camera and inside the image
+   */
+  bool project(const cv::Point3f& pos_in_field, cv::Point2f* img_pos) const;
+
+  /**
+   * Same as project(pos_in_field, img_pos) for each point, results are stored at the same index. 'valid' is optional,
+   * image positions of invalid points are unspecified.
+   */
+  void project(const std::vector<cv::Point3f>& pos_in_field, std::vector<cv::Point2f>* img_pos,
+               std::vector<uint8_t>* valid = nullptr) const;
+
+  /**
+   * Batch version of project(pos_in_field, img_pos) on structure of arrays buffers: the field position of point i is
+   * (x[i], y[i], z[i]), its image position is written to (img_x[i], img_y[i]) and its validity to valid[i] (1 or 0).
+   *
+   * Points are processed by blocks with Eigen arrays, vectorized with the instruction set enabled at compilation (SSE2,
+   * AVX...) and scalar if vectorization is not available. Computations are done in double as in the other overloads,
+   * results only differ by rounding errors. Input and output buffers should not overlap.
+   */
+  void project(const float* x, const float* y, const float* z, size_t nb_points, float* img_x, float* img_y,
+               uint8_t* valid) const;
+
+  /**
+   * Write in 'normalized' the position (x/z, y/z in the camera basis) seen at 'img_pos', the distortion is inverted
+   * with the fixed point iterations of cv::undistortPoints refined by Newton iterations. When the undistortion table
+   * is built, positions inside the image are interpolated from the table instead, iterations are only used if the
+   * interpolation is not accurate enough.
+   * Return false if no position valid for correction is found or if its projection is further than 0.01 px from
+   * img_pos.
+   */
+  bool undistort(const cv::Point2f& img_pos, cv::Point2f* normalized) const;
+
+  /**
+   * Write in 'pos_in_field' the intersection of the ray seen at 'img_pos' with the horizontal plane at height
+   * 'plane_z'. Return false if img_pos can't be undistorted or if the ray does not hit the plane in front of the
+   * camera.
+   */
+  bool imgToField(const cv::Point2f& img_pos, cv::Point3f* pos_in_field, double plane_z = 0) const;
+
+  /**
+   * Same as imgToField(img_pos, pos_in_field, plane_z) for each position, results are stored at the same index.
+   * 'valid' is optional, field positions of invalid points are unspecified.
+   */
+  void imgToField(const std::vector<cv::Point2f>& img_pos, std::vector<cv::Point3f>* pos_in_field,
+                  std::vector<uint8_t>* valid = nullptr, double plane_z = 0) const;
+
+  /**
+   * Precompute the normalized position of every pixel of the image (8 bytes per pixel), undistort then uses a bilinear
+   * interpolation of the table instead of iterations. Throws runtime_error if the image size is not specified.
+   */
+  void buildUndistortionTable();
+  bool hasUndistortionTable() const;
+
+private:
+  Eigen::Vector3d toCamera(const cv::Point3f& pos_in_field) const;
+
+  /**
+   * Position in the camera basis divided by its depth (depth is replaced by 1 if it is 0)
+   */
+  Eigen::Vector2d getNormalized(const Eigen::Vector3d& pos_in_camera) const;
+
+  bool isNormalizedValid(const Eigen::Vector2d& normalized) const;
+
+  /**
+   * Apply distortion and camera matrix to a normalized position
+   */
+  cv::Point2f normalizedToImg(const Eigen::Vector2d& normalized) const;
+
+  /**
+   * Distorted normalized position, 'jacobian' is set to its derivative with respect to 'normalized'
+   */
+  Eigen::Vector2d distort(const Eigen::Vector2d& normalized, Eigen::Matrix2d* jacobian) const;
+
+  /**
+   * Normalized position seen at img_pos, uses the undistortion table if possible, see undistort
+   */
+  bool imgToNormalized(const cv::Point2f& img_pos, Eigen::Vector2d* normalized) const;
+
+  /**
+   * Invert the distortion with iterations starting from the initial value of 'normalized', see undistort
+   */
+  bool undistortIteratively(const cv::Point2f& img_pos, Eigen::Vector2d* normalized) const;
+
+  /**
+   * Bilinear interpolation of the undistortion table, return false if img_pos is outside of the table or if one of the
+   * neighbor pixels can't be undistorted
+   */
+  bool interpolateUndistortion(const cv::Point2f& img_pos, Eigen::Vector2d* normalized) const;
+
+  /**
+   * Rotation and translation from field to camera basis
+   */
+  Eigen::Matrix3d rotation;
+  Eigen::Vector3d translation;
+
+  /**
+   * Position of the optical center in the field basis
+   */
+  Eigen::Vector3d camera_in_field;
+
+  double focal_x;
+  double focal_y;
+  double center_x;
+  double center_y;
+  cv::Size img_size;
+
+  /**
+   * Coefficients in OpenCV order, missing coefficients are 0
+   */
+  std::array<double, 12> distortion;
+
+  /**
+   * See getCorrectionRadius2
+   */
+  double correction_radius2;
+
+  /**
+   * Normalized position of pixel (x, y) at index y * img_size.width + x, NaN if it can't be undistorted. Empty if the
+   * table is not built.
+   */
+  std::vector<cv::Point2f> undistortion_table;
+};
+
+}  // namespace hl_communication
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Block-compressed container used to store large files (e.g. logs).
+ *
+ * The file starts with the magic bytes "HLGZ", followed by blocks. Each block starts with the size of its compressed
+ * data and the size of its uncompressed data (both 32 bits little-endian) followed by a gzip stream. Blocks are
+ * independent: a reader can skip blocks using their headers and decompress them in parallel. The content of the file is
+ * the concatenation of the uncompressed blocks.
+ *
+ * The first byte of the magic cannot start a serialized GameMsgCollection, therefore compressed and uncompressed logs
+ * can be distinguished automatically.
+ */
+namespace hl_communication
+{
+/**
+ * Size of the blocks written by compress() [bytes]
+ */
+const size_t DEFAULT_COMPRESSION_BLOCK_SIZE = 1 << 20;
+
+/**
+ * Maximal size of the content of a block [bytes], larger blocks are considered as malformed. Blocks written by
+ * CompressedLogWriter contain 'block_size' bytes plus at most one record
+ */
+const size_t MAX_COMPRESSED_BLOCK_SIZE = 1 << 28;
+
+/**
+ * Default maximal size of the content of a compressed container read by decompress() [bytes]
+ */
+const size_t DEFAULT_MAX_DECOMPRESSED_SIZE = UINT32_MAX;
+
+/**
+ * Size of the magic bytes at the beginning of a compressed container [bytes]
+ */
+const size_t COMPRESSION_HEADER_SIZE = 4;
+
+/**
+ * Size of the header preceding the gzip stream of each block [bytes]
+ */
+const size_t COMPRESSED_BLOCK_HEADER_SIZE = 8;
+
+/**
+ * Return true if 'data' starts with the magic bytes of a compressed container
+ */
+bool isCompressed(const char* data, size_t size);
+
+/**
+ * Return true if the file at the given path starts with the magic bytes of a compressed container.
+ * Throws runtime_error if the file cannot be opened
+ */
+bool isCompressedFile(const std::string& path);
+
+/**
+ * Append the magic bytes of a compressed container to 'buffer'
+ */
+void appendCompressionHeader(std::string* buffer);
+
+/**
+ * Compress 'data' and append it to 'buffer' as a single block.
+ * Throws logic_error if size is larger than MAX_COMPRESSED_BLOCK_SIZE, runtime_error if compression fails
+ */
+void appendCompressedBlock(const char* data, size_t size, std::string* buffer);
+
+/**
+ * Read the header of a block starting at 'data', which contains at least COMPRESSED_BLOCK_HEADER_SIZE bytes.
+ * Throws runtime_error if the sizes cannot be produced by appendCompressedBlock: the content is larger than
+ * MAX_COMPRESSED_BLOCK_SIZE or the ratio between both sizes is not possible with gzip
+ */
+void readCompressedBlockHeader(const char* data, size_t* compressed_size, size_t* uncompressed_size);
+
+/**
+ * Decompress the gzip stream of a block (without its header) and append it to 'buffer'.
+ * Throws runtime_error if the block is corrupted
+ */
+void appendDecompressedBlock(const char* data, size_t size, size_t uncompressed_size, std::string* buffer);
+
+/**
+ * Replace the content of 'out' by a compressed container storing 'data', blocks are compressed in parallel by
+ * 'nb_threads' threads, if nb_threads is 0, the number of available cores is used.
+ * Throws logic_error if block_size is 0 or larger than MAX_COMPRESSED_BLOCK_SIZE
+ */
+void compress(const char* data, size_t size, std::string* out, size_t block_size = DEFAULT_COMPRESSION_BLOCK_SIZE,
+              int nb_threads = 0);
+
+/**
+ * Replace the content of 'out' by the content of the compressed container 'data', blocks are decompressed in parallel
+ * by 'nb_threads' threads, if nb_threads is 0, the number of available cores is used.
+ *
+ * Decoding stops at the first incomplete block, the number of bytes of 'data' successfully decoded is returned.
+ * Throws runtime_error if 'data' is not a compressed container, if a complete block is corrupted or if the content is
+ * larger than 'max_size', headers are checked before allocating 'out'
+ */
+size_t decompress(const char* data, size_t size, std::string* out, int nb_threads = 0,
+                  size_t max_size = DEFAULT_MAX_DECOMPRESSED_SIZE);
+
+}  // namespace hl_communication
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <hl_communication/camera.pb.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace hl_communication
+{
+/**
+ * Index of the time stamps of the frames of a video, built once to find many frames of the same video. Lookups have
+ * the same semantics as getIndex(meta_information, time_stamp, utc):
+ * - Frames are found by binary search, with an O(1) first estimate inside segments recorded at constant frame rate
+ * - If frames are not sorted by time stamp, lookups fall back to a linear scan
+ * - If a frame misses the requested time stamp, lookups which would have read it throw logic_error
+ *
+ * The index does not reference meta_information, it should be rebuilt if frames are modified.
+ */
+class FrameIndex
+{
+public:
+  FrameIndex(const VideoMetaInformation& meta_information);
+
+  int getNbFrames() const;
+
+  /**
+   * Returns the index of the frame corresponding to the given time_stamp, see getIndex
+   */
+  int getIndex(uint64_t time_stamp, bool utc = true) const;
+
+  /**
+   * Returns the time stamp of the frame at given index, see getTimeStamp
+   */
+  uint64_t getTimeStamp(int index, bool utc = true) const;
+
+private:
+  /**
+   * Frames in which the interval between successive time stamps is almost constant
+   */
+  class Segment
+  {
+  public:
+    int begin;
+    int end;
+    uint64_t start_ts;
+    /**
+     * Average interval between two frames [us]
+     */
+    double period;
+  };
+
+  /**
+   * Time stamps of the frames for one of the clocks
+   */
+  class Clock
+  {
+  public:
+    /**
+     * Time stamps of all the frames, 0 if the frame misses the time stamp of this clock
+     */
+    std::vector<uint64_t> time_stamps;
+    std::vector<bool> available;
+    /**
+     * Lookups only use the frames preceding the first frame which misses the time stamp
+     */
+    int nb_leading;
+    /**
+     * Are the leading time stamps sorted
+     */
+    bool sorted;
+    /**
+     * Segments of the leading frames, empty if they are not sorted
+     */
+    std::vector<Segment> segments;
+  };
+
+  void buildSegments(Clock* clock);
+
+  /**
+   * Index of the first leading frame with a time stamp greater or equal to time_stamp, nb_leading if there is none.
+   * Leading time stamps must be sorted
+   */
+  int lowerBound(const Clock& clock, uint64_t time_stamp) const;
+
+  /**
+   * Throws logic_error if the frame at index misses the time stamp
+   */
+  void checkAvailable(const Clock& clock, int index, bool utc) const;
+
+  int nb_frames;
+  Clock utc_clock;
+  Clock monotonic_clock;
+};
+
+}  // namespace hl_communication
@@ -14,6 +14,121 @@ int getRedTeamColor();
 
 int charsToInt(char const* str, int start, int end);
 
+/**
+ * Location of a little-endian signed integer inside a GameController packet
+ */
+class GCField
+{
+public:
+  size_t offset;
+  size_t size;
+};
+
+/**
+ * Description of the packets of a version of the GameController protocol. Offsets of team fields are relative to the
+ * beginning of the team and offsets of robot fields are relative to the beginning of the robot.
+ */
+class GCLayout
+{
+public:
+  int version;
+  size_t packet_size;
+  GCField struct_version;
+  GCField num_player;
+  GCField game_type;
+  GCField game_state;
+  GCField first_half;
+  GCField kick_off_team;
+  GCField sec_game_state;
+  GCField secondary_team;
+  GCField secondary_mode;
+  GCField drop_in_team;
+  GCField drop_in_time;
+  GCField estimated_secs;
+  GCField secondary_secs;
+  size_t teams_offset;
+  size_t team_size;
+  GCField team_number;
+  GCField team_color;
+  GCField score;
+  /**
+   * Number of robots exported for each team, the coach and the substitutes are skipped
+   */
+  int nb_robots;
+  size_t robots_offset;
+  size_t robot_size;
+  GCField penalty;
+  GCField secs_till_unpenalised;
+  GCField yellow_card_count;
+  GCField red_card_count;
+};
+
+/**
+ * Return the layout of the GameController packets with the given version and size, nullptr if they are not supported.
+ * Several layouts may share the same version, they are then distinguished by the size of the packet.
+ *
+ * Only the two layouts of version 12 of the humanoid protocol are supported, packets of other versions are rejected:
+ * - version 12 (640 bytes)
+ * - version 12 with number_of_warnings and goal_keeper for each robot (688 bytes)
+ */
+const GCLayout* getGCLayout(int struct_version, size_t packet_size);
+
+/**
+ * Return the layout used when the size of the packet is unknown, the first supported one for the given version.
+ * Return nullptr if the version is not supported
+ */
+const GCLayout* getGCLayout(int struct_version);
+
+/**
+ * Size of a packet of the default GameController protocol version (12) [bytes]
+ */
+size_t getGCPacketSize();
+
+/**
+ * Return true if 'data' starts with the header of a GameController packet
+ */
+bool isGCPacket(char const* data, size_t size);
+
+/**
+ * Decode the GameController packet 'data' into 'msg', the result is identical to GameState::exportToGCMsg. All the
+ * fields of 'msg' except time_stamp and utc_time_stamp are overwritten, teams and robots already present in 'msg' are
+ * reused: decoding successive packets into the same GCMsg does not allocate memory.
+ *
+ * The layout is chosen according to the version and the size of the packet (see getGCLayout), each layout has its own
+ * decoder in which all offsets are compile-time constants.
+ *
+ * Return false without modifying 'msg' if the packet has an invalid header or if no layout matches its version and its
+ * size
+ */
+bool decodeGCPacket(char const* data, size_t size, GCMsg* msg);
+
+/**
+ * Content of the packets sent by the robots to the GameController
+ */
+enum GCReturnMessage
+{
+  GC_RETURN_MAN_PENALISE = 0,
+  GC_RETURN_MAN_UNPENALISE = 1,
+  GC_RETURN_ALIVE = 2
+};
+
+/**
+ * Port on which the GameController listens to the packets sent by the robots
+ */
+int getGCReturnPort();
+
+/**
+ * Size of a packet sent by a robot to the GameController (version 2) [bytes]
+ */
+size_t getGCReturnPacketSize();
+
+/**
+ * Write the packet sent by robot 'robot_id' of team 'team_id' to the GameController in 'data', nothing is allocated.
+ * Return false without modifying 'data' if 'size' is lower than getGCReturnPacketSize().
+ * Throws std::out_of_range if 'team_id' or 'robot_id' does not fit in a byte
+ */
+bool encodeGCReturnPacket(int team_id, int robot_id, GCReturnMessage message, char* data, size_t size);
+
 class Robot
 {
 public:
@@ -28,6 +143,9 @@ public:
   /*! \brief Update the robot from a referee box message */
   void updateFromMessage(char const* message, int numRobot);
 
+  /*! \brief Same as updateFromMessage for a packet described by 'layout' */
+  void updateFromMessage(char const* message, int numRobot, const GCLayout& layout);
+
   void exportToGCRobotMsg(GCRobotMsg* msg) const;
 
 private:
@@ -54,6 +172,9 @@ public:
   /*! \brief Update the robot from a referee box message */
   void updateFromMessage(char const* message, int numTeam);
 
+  /*! \brief Same as updateFromMessage for a packet described by 'layout' */
+  void updateFromMessage(char const* message, int numTeam, const GCLayout& layout);
+
   void exportToGCTeamMsg(GCTeamMsg* msg) const;
 
 private:
@@ -88,14 +209,24 @@ public:
 
   /*! \brief Update the robot from a referee box message
    * return true if there has been an update and false if
-   * the message was discarded (invalid struct version) */
+   * the message was discarded (invalid struct version).
+   * The first layout of the version is used, see getGCLayout */
   bool updateFromMessage(char const* message);
 
+  /*! \brief Same as updateFromMessage, the layout is chosen according to
+   * the version and the size of the message. The message is discarded if
+   * no layout matches */
+  bool updateFromMessage(char const* message, size_t size);
+
   void show(std::ostream& flux) const;
 
   void exportToGCMsg(GCMsg* msg) const;
 
 private:
+  /*! \brief Update the state from a message with a valid header and
+   * described by 'layout' */
+  void updateFromLayout(char const* message, const GCLayout& layout);
+
   int struct_version;
   int game_type;
   int num_player;
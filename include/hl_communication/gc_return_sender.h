@@ -0,0 +1,97 @@
+#pragma once
+
+#include <hl_communication/game_controller_utils.h>
+#include <hl_communication/udp_broadcast.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace hl_communication
+{
+/**
+ * Periodically broadcasts the packets of a robot to the GameController from a dedicated thread.
+ *
+ * Packets are sent at fixed deadlines computed from the start of the sender, the time spent sending a packet does not
+ * delay the following ones. If the thread is late by more than a period, the missed packets are skipped rather than
+ * sent in a burst.
+ */
+class GCReturnSender
+{
+public:
+  /**
+   * Start sending GC_RETURN_ALIVE packets for robot 'robot_id' of team 'team_id' at 'frequency' [Hz].
+   * Throws std::out_of_range if the identifiers do not fit in a packet and std::logic_error if frequency is not
+   * positive
+   */
+  GCReturnSender(int team_id, int robot_id, double frequency = 2, int port = getGCReturnPort());
+
+  /**
+   * Stop the thread and close the socket
+   */
+  ~GCReturnSender();
+
+  /**
+   * Change the message sent periodically, applied from the next packet
+   */
+  void setMessage(GCReturnMessage message);
+
+  /**
+   * Change the sending frequency [Hz], deadlines are recomputed from now.
+   * Throws std::logic_error if frequency is not positive
+   */
+  void setFrequency(double frequency);
+
+  double getFrequency() const;
+
+  /**
+   * Send a packet with 'message' immediately, the periodic schedule is not affected
+   */
+  void sendNow(GCReturnMessage message);
+
+  /**
+   * Number of packets sent since the creation of the sender, packets which could not be broadcasted (e.g. no broadcast
+   * address available) are not counted
+   */
+  uint64_t getNbPacketsSent() const;
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  void run();
+
+  /**
+   * Encode and broadcast a packet, caller must not own 'mutex' so that the schedule is not blocked during the send
+   */
+  void send(GCReturnMessage message);
+
+  int team_id;
+  int robot_id;
+
+  std::atomic<GCReturnMessage> message;
+  std::atomic<uint64_t> nb_packets_sent;
+
+  /**
+   * Protects the schedule
+   */
+  mutable std::mutex mutex;
+  std::condition_variable wake_up;
+
+  double frequency;
+  Clock::duration period;
+  Clock::time_point next_deadline;
+
+  /**
+   * Serializes the sends of the periodic thread and of sendNow
+   */
+  std::mutex broadcast_mutex;
+  std::unique_ptr<UDPBroadcast> broadcaster;
+
+  bool continue_to_run;
+  std::unique_ptr<std::thread> thread;
+};
+
+}  // namespace hl_communication
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Merge of several logs into a single one without loading them in memory.
+ */
+namespace hl_communication
+{
+class LogMergeSettings
+{
+public:
+  LogMergeSettings();
+
+  /**
+   * Write the merged log in a compressed container (see compression.h)
+   */
+  bool compressed;
+
+  /**
+   * Duration during which the identifier of a message is kept to detect duplicates [us]. Copies of a message received
+   * by several sources are expected to have utc time stamps closer than this window.
+   */
+  uint64_t dedup_window;
+};
+
+class LogMergeStatistics
+{
+public:
+  LogMergeStatistics();
+
+  uint64_t messages_read;
+  uint64_t messages_written;
+  uint64_t duplicates;
+};
+
+/**
+ * Merge the logs at 'input_paths' (legacy, streaming logs or compressed) into a streaming log at 'output_path'.
+ *
+ * Inputs are read message by message and merged by utc_time_stamp, the reception time converted to UTC is used for
+ * messages without utc_time_stamp. Memory usage depends on the number of inputs and on the dedup window but not on the
+ * size of the logs. The output is sorted if all the inputs are sorted. Messages sharing the same MsgIdentifier inside
+ * the dedup window are only written once.
+ *
+ * The time_offset of the output is the one of the first input defining it. Since it is the last time_offset of a log
+ * which prevails, each input is scanned once before merging, and the time_stamp of the messages is shifted so that
+ * 'time_stamp + time_offset' is preserved.
+ *
+ * Throws runtime_error if one of the files cannot be opened or is malformed
+ */
+LogMergeStatistics mergeLogs(const std::vector<std::string>& input_paths, const std::string& output_path,
+                             const LogMergeSettings& settings = LogMergeSettings());
+
+}  // namespace hl_communication
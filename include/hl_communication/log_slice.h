@@ -0,0 +1,77 @@
+#pragma once
+
+#include <hl_communication/wrapper.pb.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Extraction of a time window of a log without loading it in memory.
+ */
+namespace hl_communication
+{
+class LogSliceSettings
+{
+public:
+  LogSliceSettings();
+
+  /**
+   * Interval of utc_time_stamp kept [us], both bounds are included. Messages without utc_time_stamp are never kept.
+   */
+  uint64_t start;
+  uint64_t end;
+
+  /**
+   * If not empty, only the robot messages from these teams are kept
+   */
+  std::vector<uint32_t> team_ids;
+
+  /**
+   * If not empty, only the robot messages from these robots are kept
+   */
+  std::vector<RobotIdentifier> robots;
+
+  /**
+   * Are GameController messages kept
+   */
+  bool keep_gc;
+
+  /**
+   * Use the index of the log if it exists (see MappedMessageLog::getIndexPath)
+   */
+  bool use_index;
+
+  /**
+   * Write the slice in a compressed container (see compression.h)
+   */
+  bool compressed;
+};
+
+class LogSliceStatistics
+{
+public:
+  LogSliceStatistics();
+
+  /**
+   * Number of messages examined, only the messages in the interval are examined when the index is used
+   */
+  uint64_t messages_read;
+  uint64_t messages_written;
+  bool used_index;
+};
+
+/**
+ * Write the messages of the log at 'input_path' matching 'settings' to a streaming log at 'output_path', messages are
+ * copied without being parsed and in the order of the input.
+ *
+ * If an index exists for an uncompressed input, only the messages in the interval are read from the mapped log.
+ * Otherwise, the input is read sequentially (legacy, streaming logs or compressed). In both cases, memory usage does
+ * not depend on the size of the input.
+ *
+ * Throws runtime_error if one of the files cannot be opened or if the input is malformed
+ */
+LogSliceStatistics sliceLog(const std::string& input_path, const std::string& output_path,
+                            const LogSliceSettings& settings);
+
+}  // namespace hl_communication
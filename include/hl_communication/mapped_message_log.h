@@ -0,0 +1,191 @@
+#pragma once
+
+#include <hl_communication/message_manager.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace hl_communication
+{
+/**
+ * Read-only access to a file containing a serialized GameMsgCollection (legacy or streaming log) without loading it.
+ *
+ * The log is memory-mapped and only the messages required to answer a request are parsed. Messages are located
+ * through an index sorted by source and utc_time_stamp, the index is stored next to the log (see getIndexPath) so
+ * that opening a log which has already been indexed does not require to read it. The index is rebuilt when the size
+ * or the modification time of the log changed.
+ *
+ * Messages are handled as by MessageManager: the main GameController source is the first one appearing in the log,
+ * messages from other GameController sources are ignored.
+ */
+class MappedMessageLog
+{
+public:
+  /**
+   * Location of a message inside the log, entries are grouped by source and sorted by utc_time_stamp, ties are
+   * sorted by position in the log
+   */
+  class IndexEntry
+  {
+  public:
+    uint64_t utc_time_stamp;
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  /**
+   * A source of messages (robot or GameController) and the range of the index containing its messages
+   */
+  class IndexSource
+  {
+  public:
+    /**
+     * 1 for a GameController source, 0 for a robot
+     */
+    uint32_t is_gc;
+    /**
+     * Identifier of the robot, 0 for GameController sources
+     */
+    uint32_t team_id;
+    uint32_t robot_id;
+    /**
+     * Identifier of the GameController source, 0 for robots
+     */
+    uint32_t src_port;
+    uint64_t src_ip;
+    uint64_t begin;
+    uint64_t end;
+  };
+
+  /**
+   * Map the log at the given path and load its index, the index is built and saved if it is missing or outdated.
+   * Throws runtime_error if the log cannot be opened, is compressed or is not a valid GameMsgCollection
+   */
+  MappedMessageLog(const std::string& path);
+  ~MappedMessageLog();
+
+  MappedMessageLog(const MappedMessageLog& other) = delete;
+  MappedMessageLog& operator=(const MappedMessageLog& other) = delete;
+
+  /**
+   * Path of the file storing the index of the log at 'log_path'
+   */
+  static std::string getIndexPath(const std::string& log_path);
+
+  /**
+   * @see MessageManager::getStart
+   */
+  uint64_t getStart() const;
+
+  /**
+   * @see MessageManager::getEnd
+   */
+  uint64_t getEnd() const;
+
+  /**
+   * Return the time_offset stored in the log, 0 if there is none
+   */
+  int64_t getOffset() const;
+
+  /**
+   * Number of indexed messages, including messages from interfering GameController sources
+   */
+  size_t getNbMessages() const;
+
+  /**
+   * Return the identifiers of all the robots which sent messages
+   */
+  std::vector<RobotIdentifier> getRobots() const;
+
+  /**
+   * @see MessageManager::getStatus
+   */
+  MessageManager::Status getStatus(uint64_t time_stamp, bool system_clock = false) const;
+
+  /**
+   * @see MessageManager::getStatus
+   */
+  MessageManager::Status getStatus(uint64_t time_stamp, uint64_t history_length, bool system_clock = false) const;
+
+  /**
+   * Return the entries of the messages with a utc_time_stamp in [start, end] sent by the sources accepted by
+   * 'filter', sorted by position in the log. Unlike getStatus, messages from all the GameController sources are
+   * considered.
+   */
+  std::vector<IndexEntry> getEntries(uint64_t start, uint64_t end,
+                                     const std::function<bool(const IndexSource&)>& filter) const;
+
+  /**
+   * Return the serialized message located at 'entry', the data remains valid as long as the log is open.
+   * Throws runtime_error if the entry does not belong to the log
+   */
+  const char* getSerializedMessage(const IndexEntry& entry) const;
+
+private:
+  /**
+   * Load the index file if it matches the log, return false otherwise
+   */
+  bool loadIndex(const std::string& index_path, int64_t log_mtime);
+
+  /**
+   * Build the index by scanning the log, then try to save it to 'index_path'
+   */
+  void buildIndex(const std::string& index_path, int64_t log_mtime);
+
+  /**
+   * Write the built index to 'index_path', return false on failure
+   */
+  bool saveIndex(const std::string& index_path, int64_t log_mtime) const;
+
+  /**
+   * Release the mapped memory
+   */
+  void unmap();
+
+  /**
+   * Return the last entry of 'source' with a utc_time_stamp lower or equal to 'time_stamp', nullptr if there is none
+   */
+  const IndexEntry* findLast(const IndexSource& source, uint64_t time_stamp) const;
+
+  /**
+   * Parse the message located at 'entry'
+   */
+  void readMessage(const IndexEntry& entry, GameMsg* msg) const;
+
+  MessageManager::Status getStatus(uint64_t time_stamp, uint64_t min_ts, bool use_min_ts, bool system_clock) const;
+
+  std::string path;
+
+  /**
+   * Content of the log
+   */
+  const char* log_data;
+  size_t log_size;
+
+  /**
+   * Content of the index file, nullptr if the index could not be saved
+   */
+  void* index_data;
+  size_t index_size;
+
+  /**
+   * Used when the index could not be saved
+   */
+  std::vector<IndexSource> built_sources;
+  std::vector<IndexEntry> built_entries;
+
+  const IndexSource* sources;
+  size_t nb_sources;
+  const IndexEntry* entries;
+  size_t nb_entries;
+
+  /**
+   * Position of the main GameController source in 'sources', nb_sources if there is no GameController message
+   */
+  size_t main_gc_source;
+
+  int64_t time_offset;
+};
+
+}  // namespace hl_communication
@@ -0,0 +1,599 @@
+#pragma once
+
+#include <hl_communication/wrapper.pb.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Contains tools to read and write files storing GameMsg.
+ *
+ * Two formats are supported, both are serialized GameMsgCollection:
+ * - Legacy: the whole collection is serialized at once
+ * - Streaming log: a header (streaming_log_version and time_offset) followed by the messages appended one by one. The
+ *   file is written continuously and the last message might be truncated if the writer crashed.
+ *
+ * Both formats can be stored inside a compressed container (see compression.h), readers detect it automatically.
+ */
+namespace hl_communication
+{
+/**
+ * Current version of the streaming log format
+ */
+const uint32_t STREAMING_LOG_VERSION = 1;
+
+/**
+ * Location of a serialized GameMsg inside a serialized GameMsgCollection
+ */
+class GameMsgSpan
+{
+public:
+  size_t offset;
+  size_t size;
+};
+
+/**
+ * Scan the top-level fields of a serialized GameMsgCollection without parsing the messages.
+ * - The location of each message is appended to 'spans'
+ * - All the other fields (e.g. time_offset) are parsed into 'header'
+ *
+ * Scanning stops at the first incomplete or malformed field, the number of bytes successfully scanned is returned.
+ */
+size_t scanGameMsgCollection(const char* data, size_t size, std::vector<GameMsgSpan>* spans,
+                             GameMsgCollection* header);
+
+/**
+ * Fields of a serialized GameMsg which are required to index it
+ */
+class GameMsgSummary
+{
+public:
+  bool has_robot_msg;
+  bool has_gc_msg;
+  /**
+   * team_id and robot_id are only meaningful for robot messages with a robot_id
+   */
+  bool has_robot_id;
+  uint32_t team_id;
+  uint32_t robot_id;
+  /**
+   * utc_time_stamp of the robot_msg or the gc_msg
+   */
+  bool has_utc_time_stamp;
+  uint64_t utc_time_stamp;
+  uint64_t src_ip;
+  uint32_t src_port;
+};
+
+/**
+ * Extract the summary of a serialized GameMsg by walking through its wire format, without parsing the whole message.
+ * Returns false if the data is malformed
+ */
+bool summarizeGameMsg(const char* data, size_t size, GameMsgSummary* summary);
+
+/**
+ * Parse the messages at the given locations of 'data', work is split in chunks among 'nb_threads' threads, if
+ * nb_threads is 0, the number of available cores is used.
+ * Throws runtime_error if one of the messages cannot be parsed
+ */
+void parseGameMsgs(const char* data, const std::vector<GameMsgSpan>& spans, std::vector<GameMsg>* messages,
+                   int nb_threads = 0);
+
+/**
+ * Parse a serialized GameMsg partially: if it contains a RobotMsg, only the fields of its digest are parsed (robot_id,
+ * time_stamp, utc_time_stamp, team_play and the ball of perception), other messages are fully parsed.
+ * Returns false if the data is malformed
+ */
+bool parseGameMsgDigest(const char* data, size_t size, GameMsg* digest);
+
+/**
+ * Same as parseGameMsgs, but messages are parsed with parseGameMsgDigest. serialized[i] contains the serialized
+ * message i if it is a robot message and is empty otherwise.
+ * Throws runtime_error if one of the messages cannot be parsed
+ */
+void parseGameMsgDigests(const char* data, const std::vector<GameMsgSpan>& spans, std::vector<GameMsg>* digests,
+                         std::vector<std::string>* serialized, int nb_threads = 0);
+
+/**
+ * Read all the messages of a file containing a serialized GameMsgCollection (legacy or streaming log), messages are
+ * parsed in parallel. All the fields of the collection except the messages are stored in 'header'.
+ *
+ * A truncated message at the end of a streaming log is ignored with a warning.
+ * Throws runtime_error if the file cannot be opened or parsed
+ */
+void readGameMsgs(const std::string& path, std::vector<GameMsg>* messages, GameMsgCollection* header,
+                  int nb_threads = 0);
+
+/**
+ * Same as readGameMsgs, but messages are parsed with parseGameMsgDigests
+ */
+void readGameMsgDigests(const std::string& path, std::vector<GameMsg>* digests, std::vector<std::string>* serialized,
+                        GameMsgCollection* header, int nb_threads = 0);
+
+/**
+ * Reads the messages of a log one by one (legacy, streaming log or compressed), memory usage does not depend on the
+ * size of the log.
+ */
+class MessageLogReader
+{
+public:
+  /**
+   * Open the log at the given path, data is read from the file by chunks of 'chunk_size' bytes. Records larger than
+   * 'max_record_size' bytes are considered as malformed, memory used by the reader is bounded accordingly.
+   * Throws runtime_error if the file cannot be opened
+   */
+  MessageLogReader(const std::string& path, size_t chunk_size = 1 << 20, size_t max_record_size = 1 << 26);
+
+  /**
+   * Read the next message of the log into 'msg', returns false once the end of the log has been reached. If 'msg' is
+   * null, the message is skipped without being parsed.
+   *
+   * A truncated message at the end of a streaming log is ignored with a warning.
+   * Throws runtime_error if the log is malformed or if a record is larger than max_record_size
+   */
+  bool read(GameMsg* msg);
+
+  /**
+   * Same as read, but the message is not parsed: 'data' points to the serialized message, it remains valid until the
+   * next call to the reader.
+   */
+  bool readSerialized(const char** data, size_t* size);
+
+  /**
+   * All the fields of the collection except the messages, only the fields read so far are available: for streaming
+   * logs, time_offset might change later in the log.
+   */
+  const GameMsgCollection& getHeader() const;
+
+  const std::string& getPath() const;
+
+private:
+  /**
+   * Append data from the file to 'buffer', returns false if the end of the file has been reached
+   */
+  bool fill();
+
+  /**
+   * Append the content of the next block of a compressed log to 'buffer', returns false if there is no complete block
+   */
+  bool fillCompressed();
+
+  std::string path;
+
+  std::ifstream in;
+
+  size_t chunk_size;
+
+  size_t max_record_size;
+
+  bool compressed;
+
+  /**
+   * Data read from the file, bytes before 'buffer_pos' have already been consumed
+   */
+  std::string buffer;
+
+  size_t buffer_pos;
+
+  /**
+   * Size of the data at the end of the file which could not be decoded (e.g. truncated compressed block)
+   */
+  size_t truncated_bytes;
+
+  GameMsgCollection header;
+};
+
+/**
+ * Append to 'buffer' the header of a streaming log
+ */
+void appendLogHeader(int64_t time_offset, std::string* buffer);
+
+/**
+ * Append to 'buffer' the bytes storing 'msg' in a streaming log
+ */
+void appendLogRecord(const GameMsg& msg, std::string* buffer);
+
+/**
+ * Append to 'buffer' the bytes storing an already serialized GameMsg in a streaming log
+ */
+void appendLogRecord(const char* data, size_t size, std::string* buffer);
+
+/**
+ * Writes a streaming log, each message is written to the file with a single system call as soon as it is received.
+ */
+class MessageLogWriter
+{
+public:
+  /**
+   * Create the log at the given path, content of existing files is discarded.
+   * Throws runtime_error if the file cannot be opened
+   */
+  MessageLogWriter(const std::string& path, int64_t time_offset);
+  ~MessageLogWriter();
+
+  void write(const GameMsg& msg);
+
+  /**
+   * Same as write for an already serialized GameMsg
+   */
+  void writeSerialized(const char* data, size_t size);
+
+  /**
+   * Update the time_offset of the log, the last offset written prevails when reading the log
+   */
+  void setTimeOffset(int64_t time_offset);
+
+  const std::string& getPath() const;
+
+private:
+  void writeBuffer();
+
+  std::string path;
+
+  int fd;
+
+  /**
+   * Reused to serialize records
+   */
+  std::string buffer;
+};
+
+/**
+ * Writes a streaming log from a background thread so that the threads producing messages never wait for the disk.
+ *
+ * Records are serialized into a fixed set of buffers: write() appends to the active buffer and hands it to the
+ * background thread once it is full. The background thread writes whole buffers with large sequential writes, the
+ * active buffer is also handed over periodically so that records do not stay in memory indefinitely. Memory usage is
+ * bounded by nb_buffers * buffer_size: when all buffers are waiting to be written, write() either drops the record or
+ * waits for a buffer, depending on the caller.
+ */
+class AsyncMessageLogWriter
+{
+public:
+  class Settings
+  {
+  public:
+    Settings();
+
+    /**
+     * Capacity of each buffer [bytes]. Records larger than a buffer are dropped unless write() is allowed to wait, they
+     * are then written alone in a buffer which grows temporarily
+     */
+    size_t buffer_size;
+
+    /**
+     * Number of buffers, at least 2
+     */
+    int nb_buffers;
+
+    /**
+     * Maximal delay before a record is handed to the operating system [ms]
+     */
+    uint32_t flush_period;
+
+    /**
+     * Period between two calls to fdatasync, 0 to let the operating system decide when data reaches the disk [ms]
+     */
+    uint32_t sync_period;
+  };
+
+  /**
+   * Counters describing the activity of the writer since its creation
+   */
+  class Statistics
+  {
+  public:
+    Statistics();
+
+    /**
+     * Records accepted by write()
+     */
+    uint64_t messages_accepted;
+    uint64_t bytes_accepted;
+
+    /**
+     * Records dropped because no buffer was available or because they were larger than a buffer
+     */
+    uint64_t messages_dropped;
+    uint64_t bytes_dropped;
+
+    /**
+     * Calls to write() which had to wait for a free buffer
+     */
+    uint64_t blocked_writes;
+
+    /**
+     * Activity of the background thread
+     */
+    uint64_t nb_flushes;
+    uint64_t bytes_flushed;
+    uint64_t nb_syncs;
+    uint64_t write_errors;
+
+    /**
+     * Largest amount of data accepted but not yet written [bytes]
+     */
+    size_t max_pending_bytes;
+  };
+
+  /**
+   * Create the log at the given path, content of existing files is discarded.
+   * Throws runtime_error if the file cannot be opened
+   */
+  AsyncMessageLogWriter(const std::string& path, int64_t time_offset, const Settings& settings = Settings());
+
+  /**
+   * Write all the pending records before closing the log
+   */
+  ~AsyncMessageLogWriter();
+
+  /**
+   * Append a record to the log, returns false if the record was dropped.
+   * If 'wait_for_buffer' is false, the call never blocks on I/O and the record is dropped when all the buffers are
+   * waiting to be written or when it is larger than a buffer. Otherwise, the call waits until a buffer is available
+   * and the record is never dropped.
+   */
+  bool write(const GameMsg& msg, bool wait_for_buffer = false);
+
+  /**
+   * Same as write for an already serialized GameMsg
+   */
+  bool writeSerialized(const char* data, size_t size, bool wait_for_buffer = false);
+
+  /**
+   * Update the time_offset of the log, the last offset written prevails when reading the log. Never dropped and never
+   * blocks: if all the buffers are waiting to be written, the offset is appended by the next write() or as soon as the
+   * background thread frees a buffer.
+   */
+  void setTimeOffset(int64_t time_offset);
+
+  /**
+   * Wait until all the records accepted and the last time offset have been written to the file
+   */
+  void flush();
+
+  Statistics getStatistics() const;
+
+  const std::string& getPath() const;
+
+private:
+  /**
+   * Make sure that the active buffer can receive 'size' additional bytes, 'lock' must hold 'mutex'.
+   * Returns false if the record has to be dropped, see write()
+   */
+  bool reserve(size_t size, bool wait_for_buffer, std::unique_lock<std::mutex>& lock);
+
+  /**
+   * Append the offset received by setTimeOffset if a buffer can receive it, 'mutex' must be held
+   */
+  void appendPendingOffset();
+
+  /**
+   * Account for 'size' bytes appended to the active buffer
+   */
+  void accept(size_t size);
+
+  /**
+   * Main loop of the background thread
+   */
+  void run();
+
+  /**
+   * Write 'data' to the file, return false on failure
+   */
+  bool writeToFile(const std::string& data);
+
+  std::string path;
+
+  Settings settings;
+
+  int fd;
+
+  /**
+   * Protects all the members below
+   */
+  mutable std::mutex mutex;
+
+  /**
+   * Notified when a buffer is handed to the background thread or when a buffer has been written
+   */
+  std::condition_variable condition;
+
+  std::vector<std::string> buffers;
+
+  /**
+   * Index of the buffer receiving the records
+   */
+  int active;
+
+  /**
+   * Buffers waiting to be written, in order
+   */
+  std::deque<int> pending;
+
+  std::vector<int> free_buffers;
+
+  bool flush_requested;
+
+  bool stop_requested;
+
+  /**
+   * Time offset which could not be appended yet because no buffer was available
+   */
+  bool has_pending_offset;
+  int64_t pending_offset;
+
+  /**
+   * Bytes accepted but not written yet
+   */
+  size_t pending_bytes;
+
+  Statistics statistics;
+
+  std::thread thread;
+};
+
+/**
+ * Writes a streaming log inside a compressed container (see compression.h).
+ *
+ * Records are gathered in blocks of approximately 'block_size' bytes, full blocks are compressed and written by a
+ * worker thread. At most 'max_pending_blocks' blocks wait for compression, write() blocks when this limit is reached.
+ * Each block contains complete records, if the process crashes, only the records of the blocks not yet written are
+ * lost.
+ */
+class CompressedLogWriter
+{
+public:
+  /**
+   * Create the log at the given path, content of existing files is discarded. A block larger than
+   * MAX_COMPRESSED_BLOCK_SIZE (e.g. a huge record) is reported as a write error.
+   * Throws runtime_error if the file cannot be opened and logic_error if block_size is larger than half of
+   * MAX_COMPRESSED_BLOCK_SIZE
+   */
+  CompressedLogWriter(const std::string& path, int64_t time_offset, size_t block_size = 1 << 20,
+                      int max_pending_blocks = 2);
+
+  /**
+   * Write all the pending records before closing the log, errors are only reported on the standard error output
+   */
+  ~CompressedLogWriter();
+
+  /**
+   * Append a record to the log.
+   * Throws runtime_error if the worker thread failed to write a previous block
+   */
+  void write(const GameMsg& msg);
+
+  /**
+   * Same as write for an already serialized GameMsg
+   */
+  void writeSerialized(const char* data, size_t size);
+
+  /**
+   * Update the time_offset of the log, the last offset written prevails when reading the log
+   */
+  void setTimeOffset(int64_t time_offset);
+
+  /**
+   * Wait until all the records have been compressed and written to the file, the current block is closed even if it is
+   * not full.
+   * Throws runtime_error if the worker thread failed to write a block
+   */
+  void flush();
+
+  const std::string& getPath() const;
+
+private:
+  /**
+   * Hand the current block to the worker thread if it is full, 'lock' must hold 'mutex'
+   */
+  void closeBlock(bool force, std::unique_lock<std::mutex>& lock);
+
+  /**
+   * Throws runtime_error if the worker thread reported an error, mutex must be held
+   */
+  void checkError() const;
+
+  /**
+   * Main loop of the worker thread
+   */
+  void run();
+
+  std::string path;
+
+  size_t block_size;
+
+  int max_pending_blocks;
+
+  int fd;
+
+  /**
+   * Protects all the members below
+   */
+  std::mutex mutex;
+
+  /**
+   * Notified when a block is handed to the worker thread or when a block has been written
+   */
+  std::condition_variable condition;
+
+  /**
+   * Records which are not yet part of a full block
+   */
+  std::string current_block;
+
+  /**
+   * Blocks waiting to be compressed, in order
+   */
+  std::deque<std::string> pending;
+
+  /**
+   * Is the worker thread currently compressing or writing a block
+   */
+  bool busy;
+
+  bool stop_requested;
+
+  /**
+   * First error encountered by the worker thread, empty if none
+   */
+  std::string error;
+
+  std::thread thread;
+};
+
+/**
+ * Writes a log produced by an offline tool (e.g. merge, slice), records are never dropped and errors are reported by
+ * exceptions. The log is either compressed (see CompressedLogWriter) or written with large sequential writes by a
+ * background thread (see AsyncMessageLogWriter).
+ */
+class OfflineLogWriter
+{
+public:
+  /**
+   * Create the log at the given path, content of existing files is discarded.
+   * Throws runtime_error if the file cannot be opened
+   */
+  OfflineLogWriter(const std::string& path, int64_t time_offset, bool compressed);
+
+  /**
+   * Throws runtime_error if the message cannot be written
+   */
+  void write(const GameMsg& msg);
+
+  /**
+   * Same as write for an already serialized GameMsg
+   */
+  void writeSerialized(const char* data, size_t size);
+
+  /**
+   * Update the time_offset of the log, the last offset written prevails when reading the log
+   */
+  void setTimeOffset(int64_t time_offset);
+
+  /**
+   * Wait until all the records have been written to the file.
+   * Throws runtime_error if an error occurred while writing
+   */
+  void flush();
+
+  const std::string& getPath() const;
+
+private:
+  std::string path;
+
+  /**
+   * Exactly one of the writers is used
+   */
+  std::unique_ptr<CompressedLogWriter> compressed_writer;
+  std::unique_ptr<AsyncMessageLogWriter> writer;
+};
+
+}  // namespace hl_communication
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <hl_communication/message_log.h>
+#include <hl_communication/robot_state.h>
 #include <hl_communication/udp_message_manager.h>
 #include <hl_communication/wrapper.pb.h>
 
+#include <deque>
+#include <list>
+#include <memory>
+
 namespace hl_communication
 {
 /**
@@ -43,6 +49,119 @@ public:
     CONFLICT
   };
 
+  /**
+   * Immutable view of the history of a MessageManager, see enableConcurrentReaders()
+   */
+  class Snapshot
+  {
+  public:
+    Snapshot();
+
+    /**
+     * @see MessageManager::getStart
+     */
+    uint64_t getStart() const;
+
+    /**
+     * @see MessageManager::getEnd
+     */
+    uint64_t getEnd() const;
+
+    /**
+     * @see MessageManager::getStatus
+     */
+    Status getStatus(uint64_t time_stamp, bool system_clock = false) const;
+
+    /**
+     * @see MessageManager::getStatus
+     */
+    Status getStatus(uint64_t time_stamp, uint64_t history_length, bool system_clock = false) const;
+
+    /**
+     * States of the robots when the snapshot was published, empty if robot states are not enabled.
+     * @see MessageManager::getRobotStates
+     */
+    const RobotStateTable& getRobotStates() const;
+
+  private:
+    friend class MessageManager;
+
+    /**
+     * History of an entity stored as a few immutable segments ordered by publication, segments are shared between
+     * successive snapshots. Entries older than 'floor' have been evicted and are ignored.
+     */
+    template <typename T>
+    class SegmentedHistory
+    {
+    public:
+      SegmentedHistory();
+
+      /**
+       * Return the last entry with a time_stamp lower or equal to 'time_stamp', nullptr if there is none.
+       * If multiple segments contain the same time_stamp, the most recent segment is used.
+       */
+      const T* find(uint64_t time_stamp, uint64_t* entry_ts) const;
+
+      /**
+       * Return the first time_stamp of the history, max uint64_t if empty
+       */
+      uint64_t getStart() const;
+
+      /**
+       * Return the last time_stamp of the history, 0 if empty
+       */
+      uint64_t getEnd() const;
+
+      /**
+       * Add the given entries as a new segment and update the floor. Segments are merged to keep their number
+       * logarithmic in the number of entries. If the floor decreases (late message), entries below the previous floor
+       * are dropped from the segments since they have been evicted.
+       */
+      void update(std::map<uint64_t, T>&& entries, uint64_t new_floor);
+
+    private:
+      std::vector<std::shared_ptr<const std::map<uint64_t, T>>> segments;
+      uint64_t floor;
+    };
+
+    Status getStatus(uint64_t time_stamp, uint64_t min_ts, bool use_min_ts, bool system_clock) const;
+
+    std::map<RobotIdentifier, SegmentedHistory<RobotMsg>> robots;
+    SegmentedHistory<GCMsg> gc;
+    int64_t clock_offset;
+    RobotStateTable robot_states;
+  };
+
+  /**
+   * Limits on the amount of messages kept in memory, oldest messages are evicted first. A limit set to 0 is disabled.
+   */
+  class RetentionPolicy
+  {
+  public:
+    RetentionPolicy();
+
+    /**
+     * Messages older than 'max_age' with respect to the last message received are evicted [us]
+     */
+    uint64_t max_age;
+
+    /**
+     * Maximal number of messages stored for each robot
+     */
+    size_t max_messages_by_robot;
+
+    /**
+     * Maximal size of all the stored messages once serialized [bytes]
+     */
+    size_t max_bytes;
+
+    /**
+     * If not empty, evicted messages are appended to a streaming log at the given path before being dropped. Previous
+     * content of the file is discarded when the path changes.
+     */
+    std::string spill_path;
+  };
+
   /**
    * Default implementation: no receivers opened
    */
@@ -65,7 +184,96 @@ public:
 
   void update();
 
-  void saveMessages(const std::string& path);
+  /**
+   * Write all the messages received in a log at the given path, messages are streamed to the file without building
+   * an intermediate GameMsgCollection. If 'compressed' is true, the log is written in a compressed container (see
+   * compression.h), loadMessages detects compressed logs automatically.
+   */
+  void saveMessages(const std::string& path, bool compressed = false);
+
+  /**
+   * Write all the messages received to a streaming log at the given path and append all the messages received
+   * afterwards as soon as they are pushed. If the process crashes, only the message being written can be lost.
+   * Throws runtime_error if the file cannot be opened
+   */
+  void startStreamingLog(const std::string& path);
+
+  /**
+   * Same as startStreamingLog, but the log is written by a background thread so that pushing messages never waits for
+   * the disk. Messages received while all the buffers of the writer are full are not written to the log, they are
+   * still stored by the MessageManager. If the process crashes, the content of the buffers is lost.
+   * Throws runtime_error if the file cannot be opened
+   */
+  void startStreamingLog(const std::string& path, const AsyncMessageLogWriter::Settings& settings);
+
+  /**
+   * Return the statistics of the background writer of the streaming log.
+   * Throws logic_error if no streaming log was started with a background writer
+   */
+  AsyncMessageLogWriter::Statistics getStreamingLogStatistics() const;
+
+  /**
+   * Error which stopped the streaming log, empty if none occurred since the log was started. A write error while
+   * pushing a message closes the streaming log instead of being thrown, the message is still stored.
+   */
+  const std::string& getStreamingLogError() const;
+
+  /**
+   * Close the streaming log if one was opened, pending messages are written before closing it
+   */
+  void stopStreamingLog();
+
+  /**
+   * Once enabled, update() and loadMessages() publish an immutable snapshot of the history after ingesting messages.
+   * getStatus, getStart and getEnd are then served from the last published snapshot and can be called from multiple
+   * threads without blocking ingestion. Snapshots share their content with the next ones but duplicate the messages
+   * stored by the MessageManager.
+   *
+   * Should be called before starting any reader thread.
+   * Throws logic_error if lazy decoding is enabled
+   */
+  void enableConcurrentReaders();
+
+  /**
+   * Once enabled, robot messages are stored serialized along with a digest: a RobotMsg containing only robot_id,
+   * time_stamp, utc_time_stamp, team_play and the ball of perception. Messages loaded from files are only partially
+   * parsed. Full messages are decoded when they are accessed (getStatus, StatusCursor), the last 'cache_size' decoded
+   * messages are kept in a cache.
+   *
+   * Should be called before any message is stored.
+   * Throws logic_error if messages have already been stored or if concurrent readers are enabled
+   */
+  void enableLazyDecoding(size_t cache_size = 64);
+
+  /**
+   * Once enabled, a main GameController message whose content is identical to the state in force at its emission
+   * (ignoring time stamps) is not stored: only a marker with its time stamps and its packet number is kept. getStatus,
+   * StatusCursor, getTeamColor, snapshots, saved and spilled logs behave as if all the messages had been stored.
+   *
+   * Should be called before any message is stored.
+   * Throws logic_error if messages have already been stored
+   */
+  void enableGCChangeDetection();
+
+  /**
+   * Once enabled, the state of the last message of each robot (see RobotState) is maintained in a table updated when
+   * messages are pushed or evicted. If lazy decoding is enabled, only the last message of a robot is decoded.
+   */
+  void enableRobotStates();
+
+  /**
+   * Return the states of the robots according to their last message, rows are removed when all the messages of a
+   * robot have been evicted. The table is modified in place by the thread ingesting messages, it must not be read from
+   * other threads: they should use Snapshot::getRobotStates (see enableConcurrentReaders).
+   * Throws logic_error if robot states are not enabled
+   */
+  const RobotStateTable& getRobotStates() const;
+
+  /**
+   * Return the last published snapshot, nullptr if concurrent readers are not enabled.
+   * Can be called from any thread.
+   */
+  std::shared_ptr<const Snapshot> getSnapshot() const;
 
   /**
    * Return the timestamp of the first message received
@@ -90,6 +298,16 @@ public:
    */
   Status getStatus(uint64_t time_stamp, uint64_t history_length, bool system_clock = false) const;
 
+  /**
+   * Same as getStatus, but if lazy decoding is enabled, the robot messages of the status are digests and no message
+   * is decoded
+   */
+  Status getStatusDigest(uint64_t time_stamp, bool system_clock = false) const;
+
+  /**
+   * Return the color of the team of 'robot_id' according to the last main GameController message prior to utc_ts.
+   * Lookup is O(log(nb_gc_messages)) and does not copy any message, if a team appears twice, the first entry is used
+   */
   TeamColor getTeamColor(uint64_t utc_ts, const RobotIdentifier& robot_id) const;
 
   const std::map<RobotIdentifier, TeamColor>& getRobotsColors() const;
@@ -106,7 +324,22 @@ public:
 
   void loadMessages(const std::string& file_path);
 
+  /**
+   * Set the limits of the history, messages outside of the limits are immediately evicted.
+   * Throws runtime_error if the spill file cannot be opened.
+   */
+  void setRetentionPolicy(const RetentionPolicy& policy);
+
+  const RetentionPolicy& getRetentionPolicy() const;
+
+  /**
+   * Return the size of the messages currently stored once serialized [bytes]
+   */
+  size_t getStoredBytes() const;
+
 private:
+  friend class StatusCursor;
+
   /**
    * Open an udp receiver on given port, throws logic_error if port is already opened with this message manager
    */
@@ -118,9 +351,9 @@ private:
   void push(const RobotMsg& msg);
 
   /**
-   * Check if we already
+   * Check if the main source of GameController messages has already been elected, it is kept even if all its messages
+   * have been evicted
    */
-
   bool hasMainGCSource();
 
   /**
@@ -131,15 +364,181 @@ private:
   void push(const GameMsgCollection& collection);
 
   /**
-   * Gather all the received messages in a GameMsgCollection
+   * Push all the messages at once, team colors of the robots are resolved after all messages have been stored.
+   * Content of 'messages' is moved to the internal containers.
+   *
+   * Messages are sorted once by identifier and once by time, the containers are then filled with hinted insertions:
+   * building the indices of a log does not cost a full lookup per message and container.
+   */
+  void push(std::vector<GameMsg>&& messages);
+
+  /**
+   * Same as push, for messages read with readGameMsgDigests
+   */
+  void push(std::vector<GameMsg>&& digests, std::vector<std::string>&& serialized);
+
+  /**
+   * Main GameController message stored as a marker, see enableGCChangeDetection
+   */
+  class GCRepeat
+  {
+  public:
+    uint64_t utc_time_stamp;
+    uint64_t time_stamp;
+    uint64_t packet_no;
+
+    /**
+     * Content of the message except for time stamps, shared by all the repeats of the same state
+     */
+    std::shared_ptr<const GCMsg> state;
+  };
+
+  /**
+   * A main GameController message, either stored in main_gc_messages or as a repeat
+   */
+  class GCEntry
+  {
+  public:
+    uint64_t utc_time_stamp;
+
+    /**
+     * The stored message or the state of the repeat
+     */
+    const GCMsg* content;
+
+    /**
+     * nullptr if the message is stored in main_gc_messages
+     */
+    const GCRepeat* repeat;
+  };
+
+  /**
+   * Store the message in all the containers without enforcing retention policy.
+   * If 'serialized' is not empty, 'msg' is the digest of the serialized message.
+   * Return the stored message or nullptr if it has already been received or if it has been stored as a repeat.
+   */
+  const GameMsg* store(GameMsg&& msg, std::string&& serialized);
+
+  /**
+   * Add the message to the containers indexed by time: messages_by_robot or the GameController messages, and
+   * received_by_time
+   */
+  void indexByTime(const GameMsg& msg);
+
+  /**
+   * Account for the size of the message stored in received_messages, keep its serialized content if it is not empty
+   * and append it to the streaming log
+   */
+  void storeContent(const MsgIdentifier& msg_id, const GameMsg& msg, std::string&& serialized);
+
+  /**
+   * Append a message to the streaming log if there is one, the log is closed if an error occurs (see
+   * getStreamingLogError)
+   */
+  void streamMessage(const MsgIdentifier& msg_id, const GameMsg& msg);
+
+  /**
+   * If GameController change detection is enabled and 'msg' is a repeat of the main GameController state in force at
+   * its emission, store it as a repeat and return true
+   */
+  bool storeGCRepeat(const GameMsg& msg);
+
+  /**
+   * Find the last main GameController message with an utc_time_stamp lower or equal to 'time_stamp', taking repeats
+   * into account. Return false if there is none
+   */
+  bool findGCMsg(uint64_t time_stamp, GCEntry* entry) const;
+
+  /**
+   * Select the most recent between the message at 'msg_it' (end() if there is none) and the last of the first
+   * 'nb_repeats' repeats. Return false if there is none
+   */
+  bool getGCEntry(std::map<uint64_t, GCMsg>::const_iterator msg_it, size_t nb_repeats, GCEntry* entry) const;
+
+  /**
+   * Copy the message referenced by 'entry' to 'msg'
+   */
+  void exportGCMsg(const GCEntry& entry, GCMsg* msg) const;
+
+  /**
+   * Rebuild the GameMsg received for 'repeat'
+   */
+  GameMsg buildGameMsg(const GCRepeat& repeat) const;
+
+  Status getStatus(uint64_t time_stamp, uint64_t min_ts, bool use_min_ts, bool system_clock, bool decode) const;
+
+  /**
+   * Return the full content of the message of 'robot_id' stored at 'utc_ts', 'stored' is the message stored in
+   * messages_by_robot. The returned reference is valid until the next call.
+   */
+  const RobotMsg& getRobotMsg(const RobotIdentifier& robot_id, uint64_t utc_ts, const RobotMsg& stored) const;
+
+  /**
+   * Return the entry of received_by_time of the message stored in messages_by_robot for 'robot_id' at 'utc_ts'.
+   * Throws logic_error if there is none
+   */
+  std::multimap<uint64_t, MsgIdentifier>::const_iterator findRobotMsg(const RobotIdentifier& robot_id,
+                                                                      uint64_t utc_ts) const;
+
+  /**
+   * Write the stored message to 'writer', serialized content is used for messages stored lazily
+   */
+  template <typename Writer>
+  void writeStored(const MsgIdentifier& msg_id, const GameMsg& msg, Writer* writer) const;
+
+  /**
+   * Set the row of 'robot_id' in robot_states from its last stored message, the row is removed if the robot has no
+   * message. Does nothing if robot states are disabled
+   */
+  void updateRobotState(const RobotIdentifier& robot_id);
+
+  /**
+   * Update the team color of the robot emitting 'msg' in active_robots_colors
+   */
+  void updateRobotColor(const RobotMsg& msg);
+
+  /**
+   * Return the timestamp of the last message stored, ignoring published snapshots
+   */
+  uint64_t getHistoryEnd() const;
+
+  /**
+   * Evict messages until the retention policy is respected
+   */
+  void enforceRetention();
+
+  /**
+   * Remove the message referenced by 'it' from all the containers, spilling it if required
+   */
+  void evict(std::multimap<uint64_t, MsgIdentifier>::const_iterator it);
+
+  /**
+   * Remove the oldest message or GameController repeat, return false if nothing is stored
+   */
+  bool evictOldest();
+
+  /**
+   * Return the utc_time_stamp of the oldest message or GameController repeat, max uint64_t if nothing is stored
+   */
+  uint64_t getOldestTimeStamp() const;
+
+  /**
+   * Publish the messages pushed since the last snapshot, does nothing if concurrent readers are disabled
    */
-  GameMsgCollection buildGameMsgCollection() const;
+  void publishSnapshot();
 
   /**
    * Messages received ordered by robot identifier and then by emission utc_time_stamp
    */
   std::map<RobotIdentifier, TimedRobotMsgCollection> messages_by_robot;
 
+  /**
+   * Entry of received_by_time of each message stored in messages_by_robot. Messages of a robot sharing an
+   * utc_time_stamp replace each other in messages_by_robot, while all of them are kept in received_messages.
+   */
+  std::map<RobotIdentifier, std::map<uint64_t, std::multimap<uint64_t, MsgIdentifier>::const_iterator>>
+      robot_msg_entries;
+
   /**
    * Game Controller messages received ordered by emission time_stamp utc
    */
@@ -150,6 +549,13 @@ private:
    */
   std::map<uint64_t, GCMsg> interfering_gc_messages;
 
+  /**
+   * Entry of received_by_time of each message stored in main_gc_messages and interfering_gc_messages, see
+   * robot_msg_entries
+   */
+  std::map<uint64_t, std::multimap<uint64_t, MsgIdentifier>::const_iterator> main_gc_entries;
+  std::map<uint64_t, std::multimap<uint64_t, MsgIdentifier>::const_iterator> interfering_gc_entries;
+
   /**
    * Offset between clock used for internal time_stamps and UTC time_stamp [us]:
    * msg.time_stamp + time_offset = utc_time_stamp
@@ -161,6 +567,74 @@ private:
    */
   std::map<MsgIdentifier, GameMsg> received_messages;
 
+  /**
+   * Identifiers of the received messages ordered by utc_time_stamp, used to evict oldest messages first
+   */
+  std::multimap<uint64_t, MsgIdentifier> received_by_time;
+
+  /**
+   * Sum of the serialized size of the messages in received_messages [bytes]
+   */
+  size_t stored_bytes;
+
+  /**
+   * Number of messages and GameController repeats evicted so far, used by StatusCursor to detect that its iterators
+   * might have been invalidated
+   */
+  uint64_t nb_evictions;
+
+  bool lazy_decoding;
+
+  /**
+   * Serialized content of the messages stored lazily, received_messages and messages_by_robot contain their digest
+   */
+  std::map<MsgIdentifier, std::string> serialized_messages;
+
+  /**
+   * Decoded messages which have been accessed recently, most recent first
+   */
+  size_t decoded_cache_size;
+  mutable std::list<std::pair<MsgIdentifier, RobotMsg>> decoded_cache;
+  mutable std::map<MsgIdentifier, std::list<std::pair<MsgIdentifier, RobotMsg>>::iterator> decoded_cache_index;
+
+  bool gc_change_detection;
+
+  /**
+   * Main GameController messages stored as markers, ordered by utc_time_stamp
+   */
+  std::deque<GCRepeat> gc_repeats;
+
+  /**
+   * States of the messages of main_gc_messages which have repeats, indexed by utc_time_stamp
+   */
+  std::map<uint64_t, std::shared_ptr<const GCMsg>> gc_repeated_states;
+
+  bool robot_states_enabled;
+
+  /**
+   * State of the last message stored for each robot
+   */
+  RobotStateTable robot_states;
+
+  RetentionPolicy retention_policy;
+
+  /**
+   * Log to which evicted messages are appended, null if spilling is disabled
+   */
+  std::unique_ptr<MessageLogWriter> spill_log;
+
+  /**
+   * Log to which messages are appended when they are received, null if streaming is disabled
+   */
+  std::unique_ptr<MessageLogWriter> streaming_log;
+
+  /**
+   * Log written by a background thread, null if streaming is disabled or uses streaming_log
+   */
+  std::unique_ptr<AsyncMessageLogWriter> async_streaming_log;
+
+  std::string streaming_log_error;
+
   std::map<int, std::unique_ptr<UDPMessageManager>> udp_receivers;
 
   /**
@@ -168,6 +642,11 @@ private:
    */
   SourceIdentifier main_gc_source;
 
+  /**
+   * Has main_gc_source been elected, the first source of GameController messages is elected
+   */
+  bool has_main_gc_source;
+
   /**
    * Stores the list of unwanted provider of game controller messages.
    */
@@ -180,6 +659,19 @@ private:
   bool auto_discover_ports;
 
   std::map<RobotIdentifier, TeamColor> active_robots_colors;
+
+  bool concurrent_readers;
+
+  /**
+   * Last published snapshot, only accessed through std::atomic_load and std::atomic_store
+   */
+  std::shared_ptr<const Snapshot> snapshot;
+
+  /**
+   * Messages pushed since the last snapshot was published
+   */
+  std::map<RobotIdentifier, TimedRobotMsgCollection> pending_robot_messages;
+  std::map<uint64_t, GCMsg> pending_gc_messages;
 };
 
 bool operator<(const MessageManager::SourceIdentifier& id1, const MessageManager::SourceIdentifier& id2);
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <hl_communication/wrapper.pb.h>
+
+#include <Eigen/Core>
+
+#include <cstdint>
+#include <vector>
+
+namespace hl_communication
+{
+/**
+ * Write in 'covariance' the covariance matrix of the position and return true if its uncertainty is informed. As
+ * specified in PositionDistribution, 2 coefficients are standard deviations along x and y while 3 coefficients are
+ * covariances (x, xy, y)
+ */
+bool getCovariance(const PositionDistribution& position, Eigen::Matrix2d* covariance);
+
+/**
+ * Position in the field [m] and its covariance [m^2]
+ */
+class FieldPosition
+{
+public:
+  Eigen::Vector2d position;
+  Eigen::Matrix2d covariance;
+};
+
+/**
+ * A robot perceived by another robot, expressed in the field
+ */
+class FieldRobot
+{
+public:
+  /**
+   * Probability that the detection is accurate
+   */
+  float probability;
+  /**
+   * Identifier of the robot, 0 if it is unknown
+   */
+  uint32_t team_id;
+  uint32_t robot_id;
+  FieldPosition position;
+  /**
+   * Direction of the robot [rad] and its standard deviation
+   */
+  double dir;
+  double dir_std_dev;
+};
+
+/**
+ * Content of a Perception expressed in the field, flags tell if the optional fields were provided
+ */
+class PerceptionInField
+{
+public:
+  bool has_ball;
+  FieldPosition ball;
+  bool has_opp_goal;
+  FieldPosition opp_goal;
+  std::vector<FieldRobot> robots;
+};
+
+/**
+ * Convert the ball, the opponent goal and all the robots of 'perception' from the self basis to the field according to
+ * 'self_in_field', the rotation is computed once for the whole perception. 'result' can be reused between calls to
+ * avoid allocations.
+ *
+ * Covariances of self_in_field, of its direction and of the perceived objects are propagated with a first order
+ * approximation, uncertainties which are not informed are considered as 0. Correlations between position and
+ * direction are ignored.
+ */
+void fieldFromSelf(const PoseDistribution& self_in_field, const Perception& perception, PerceptionInField* result);
+
+/**
+ * Convert the perception of the robot according to its most probable entry of perception.self_in_field, return false
+ * if the message contains no pose
+ */
+bool getPerceptionInField(const RobotMsg& msg, PerceptionInField* result);
+
+}  // namespace hl_communication
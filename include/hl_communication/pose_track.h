@@ -0,0 +1,71 @@
+#pragma once
+
+#include <hl_communication/frame_index.h>
+
+#include <Eigen/Geometry>
+
+#include <cstdint>
+#include <vector>
+
+namespace hl_communication
+{
+/**
+ * Poses of the camera of a video at any time stamp, poses are transformations from field to camera as in FrameEntry.
+ *
+ * The pose of each frame is computed once at construction:
+ * - Frames with a pose use it
+ * - STATIC frames use the pose of the previous frame
+ * - MOVING and UNKNOWN_FRAME_STATUS frames are interpolated between the closest frames with a pose
+ * - SHAKING frames, and frames which can't be interpolated, use default_pose if it is available, they have no pose
+ *   otherwise
+ *
+ * Between two frames, poses are interpolated (slerp for the orientation, linear for the position of the camera in the
+ * field) unless one of the frames is SHAKING, the pose of the previous frame is used in this case. Queries cost
+ * O(log(nb_frames)), see FrameIndex.
+ */
+class PoseTrack
+{
+public:
+  /**
+   * Use the utc or the monotonic time stamps of the frames
+   */
+  PoseTrack(const VideoMetaInformation& meta_information, bool utc = true);
+
+  /**
+   * Write in 'pose' the pose of the camera at time_stamp and return true if it is available. There is no pose before
+   * the first frame and the pose of the last frame is used after it.
+   *
+   * Throws logic_error if a frame needed for the query misses its time stamp, see getIndex
+   */
+  bool getPose(uint64_t time_stamp, Eigen::Affine3d* pose) const;
+
+  /**
+   * Throws runtime_error if no pose is available at time_stamp
+   */
+  Eigen::Affine3d getPose(uint64_t time_stamp) const;
+
+  /**
+   * Write in 'pose' the pose of the frame at index and return true if it is available.
+   * Throws out_of_range if index is not valid
+   */
+  bool getFramePose(int index, Eigen::Affine3d* pose) const;
+
+private:
+  /**
+   * Can the pose of the frame at index be interpolated with its neighbors
+   */
+  bool isInterpolable(int index) const;
+
+  bool utc;
+  FrameIndex frame_index;
+
+  std::vector<FrameStatus> status;
+
+  /**
+   * Is the pose of each frame known
+   */
+  std::vector<uint8_t> known;
+  std::vector<Eigen::Affine3d> poses;
+};
+
+}  // namespace hl_communication
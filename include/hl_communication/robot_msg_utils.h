@@ -18,7 +18,8 @@ uint64_t getAge(const RobotMsg& msg);
 
 /**
  * Convert the given position distribution in self referential to world referential.
- * DISCLAIMER: currently, the resulting PositionDistribution does not take into account uncertainties
+ * DISCLAIMER: currently, the resulting PositionDistribution does not take into account uncertainties, see
+ * fieldFromSelf in perception_in_field.h to convert a whole perception with its uncertainties
  */
 PositionDistribution fieldFromSelf(const PoseDistribution& robot_in_field, const PositionDistribution& pos_in_self);
 
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <hl_communication/wrapper.pb.h>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Flat representation of the content of RobotMsg used by strategies, avoids walking through protobuf accessors.
+ */
+namespace hl_communication
+{
+/**
+ * Plain copy of the most used fields of a RobotMsg, positions are in [m] and angles in [rad]. Fields guarded by a flag
+ * are set to 0 when the flag is false.
+ */
+class RobotState
+{
+public:
+  uint32_t team_id;
+  uint32_t robot_id;
+
+  /**
+   * Reception time_stamp (steady clock of the receiver) and emission utc_time_stamp [us], 0 if not provided
+   */
+  uint64_t time_stamp;
+  uint64_t utc_time_stamp;
+
+  /**
+   * Most probable entry of perception.self_in_field
+   */
+  bool has_pose;
+  float pose_x;
+  float pose_y;
+  float pose_dir;
+  float pose_probability;
+
+  /**
+   * perception.ball_in_self
+   */
+  bool has_ball;
+  float ball_x;
+  float ball_y;
+
+  /**
+   * Ball in field referential according to the most probable pose, requires both has_pose and has_ball
+   */
+  bool has_ball_in_field;
+  float ball_field_x;
+  float ball_field_y;
+
+  Role role;
+  Status status;
+
+  /**
+   * intention.action_planned
+   */
+  Action action;
+};
+
+/**
+ * Extract the state of the robot from 'msg', robot_id must be set
+ */
+RobotState getRobotState(const RobotMsg& msg);
+
+/**
+ * States of multiple robots stored as a structure of arrays: one column per field of RobotState, one row per robot.
+ * Rows are sorted by team_id and then by robot_id, so that team-wide queries are loops over contiguous columns.
+ *
+ * Columns are public for read access and all have the same size, they should only be modified through update, erase
+ * and clear.
+ */
+class RobotStateTable
+{
+public:
+  /**
+   * Return the number of robots in the table
+   */
+  size_t size() const;
+
+  /**
+   * Return the row of the given robot, -1 if the robot is not in the table
+   */
+  int findRow(uint32_t team_id, uint32_t robot_id) const;
+
+  /**
+   * Gather the columns of the given row
+   */
+  RobotState getState(size_t row) const;
+
+  /**
+   * Set the row of the robot of 'state', a row is inserted if the robot is not in the table yet
+   */
+  void update(const RobotState& state);
+
+  /**
+   * Remove the row of the given robot if it exists
+   */
+  void erase(uint32_t team_id, uint32_t robot_id);
+
+  void clear();
+
+  /**
+   * Return the row of the robot of 'team_id' closest to the ball according to its own perception, -1 if no robot of
+   * the team sees the ball
+   */
+  int findClosestToBall(uint32_t team_id) const;
+
+  std::vector<uint32_t> team_ids;
+  std::vector<uint32_t> robot_ids;
+  std::vector<uint64_t> time_stamps;
+  std::vector<uint64_t> utc_time_stamps;
+  // Flags are stored as bytes to keep the columns contiguous
+  std::vector<uint8_t> has_pose;
+  std::vector<float> pose_x;
+  std::vector<float> pose_y;
+  std::vector<float> pose_dir;
+  std::vector<float> pose_probability;
+  std::vector<uint8_t> has_ball;
+  std::vector<float> ball_x;
+  std::vector<float> ball_y;
+  std::vector<uint8_t> has_ball_in_field;
+  std::vector<float> ball_field_x;
+  std::vector<float> ball_field_y;
+  std::vector<Role> roles;
+  std::vector<Status> statuses;
+  std::vector<Action> actions;
+
+private:
+  /**
+   * Return the first row which is not ordered before the given robot
+   */
+  size_t lowerBound(uint32_t team_id, uint32_t robot_id) const;
+};
+
+}  // namespace hl_communication
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <hl_communication/message_manager.h>
+
+namespace hl_communication
+{
+/**
+ * Produces successive Status of a MessageManager for increasing time stamps (e.g. log replay). Only the entities whose
+ * last message changed are updated, therefore replaying a whole log costs O(nb_messages) instead of
+ * O(nb_frames * nb_robots * log(nb_messages)).
+ *
+ * The cursor reads the history of the manager directly:
+ * - It should be used from the thread updating the manager
+ * - Messages received with a time stamp older than the cursor are only taken into account after a seek
+ * - Evictions from the manager are detected by advance: the iterators are then positioned again with a binary search
+ *   and robots whose messages have all been evicted are removed from the status
+ */
+class StatusCursor
+{
+public:
+  /**
+   * Creates a cursor positioned before the first message
+   */
+  StatusCursor(const MessageManager& manager);
+
+  /**
+   * Creates a cursor ignoring messages older than "time_stamp - history_length"
+   */
+  StatusCursor(const MessageManager& manager, uint64_t history_length);
+
+  /**
+   * Move the cursor to the given time_stamp and rebuild the status, cost is O(nb_robots * log(nb_messages))
+   *
+   * - The system_clock option allows to specify that the time_stamp is not based on steady clock, but on a system
+   *   clock
+   */
+  void seek(uint64_t time_stamp, bool system_clock = false);
+
+  /**
+   * Move the cursor forward to the given time_stamp, only processing the messages between previous and new time_stamp.
+   * If time_stamp is older than the current time_stamp, a seek is performed.
+   *
+   * Return true if the status has changed
+   */
+  bool advance(uint64_t time_stamp, bool system_clock = false);
+
+  /**
+   * Return the status at the current time_stamp, identical to MessageManager::getStatus
+   */
+  const MessageManager::Status& getStatus() const;
+
+  /**
+   * Return the current time_stamp of the cursor (steady clock)
+   */
+  uint64_t getTimeStamp() const;
+
+  /**
+   * Robots whose entry in the status has been added, modified or removed by the last seek or advance
+   */
+  const std::vector<RobotIdentifier>& getChangedRobots() const;
+
+  /**
+   * Return true if the GameController message has been modified by the last seek or advance
+   */
+  bool hasGCChanged() const;
+
+private:
+  typedef MessageManager::TimedRobotMsgCollection::const_iterator RobotMsgIterator;
+
+  /**
+   * Moves all iterators to the new time_stamp and updates the status with the entities which changed
+   */
+  void update(uint64_t new_time_stamp, bool reset);
+
+  const MessageManager& manager;
+
+  bool use_history_length;
+  uint64_t history_length;
+
+  uint64_t time_stamp;
+
+  /**
+   * For each robot, last message prior to time_stamp, end() if there is none
+   */
+  std::map<RobotIdentifier, RobotMsgIterator> robot_iterators;
+
+  /**
+   * Last main GameController message prior to time_stamp, end() if there is none
+   */
+  std::map<uint64_t, GCMsg>::const_iterator gc_iterator;
+
+  /**
+   * Number of GameController repeats prior to time_stamp
+   */
+  size_t nb_gc_repeats;
+
+  /**
+   * Value of MessageManager::nb_evictions when the iterators were last updated
+   */
+  uint64_t nb_evictions;
+
+  MessageManager::Status status;
+
+  std::vector<RobotIdentifier> changed_robots;
+
+  bool gc_changed;
+};
+
+}  // namespace hl_communication
@@ -44,9 +44,9 @@ public:
   void closeWrite();
 
   /**
-   * Broadcast given UDP message
+   * Broadcast given UDP message, return true if it was entirely sent to at least one broadcast address
    */
-  void broadcastMessage(const char* data, size_t len);
+  bool broadcastMessage(const char* data, size_t len);
 
   /**
    * Return true of the given bufffer has been
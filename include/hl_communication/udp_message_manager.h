@@ -15,6 +15,15 @@ namespace hl_communication
  */
 int getDefaultTeamPort(int team_id);
 
+/**
+ * Decode a packet received by UDPMessageManager into 'msg': GameController packets are decoded with decodeGCPacket,
+ * other packets are parsed as GameMsg. When successive GameController packets are decoded into the same 'msg', its
+ * GCMsg is reused, the result is the same as with a new 'msg'. Time stamps and identifiers are not set. Unknown fields
+ * of GameMsg containing a GCMsg are discarded.
+ * Return false if the packet is invalid, content of 'msg' is then unspecified
+ */
+bool decodeReceivedPacket(const char* data, size_t len, GameMsg* msg);
+
 class UDPMessageManager
 {
 private:
@@ -50,9 +50,15 @@ bool operator<(const RobotCameraIdentifier& id1, const RobotCameraIdentifier& id
  */
 bool operator<(const VideoSourceID& id1, const VideoSourceID& id2);
 
+/**
+ * Parse the content of the file at the given path into 'msg', compressed files are detected automatically
+ */
 void readFromFile(const std::string& path, google::protobuf::Message* msg);
 
-void writeToFile(const std::string& path, const google::protobuf::Message& msg);
+/**
+ * Serialize 'msg' to the given path, if 'compressed' is true, the file is a compressed container (see compression.h)
+ */
+void writeToFile(const std::string& path, const google::protobuf::Message& msg, bool compressed = false);
 
 /**
  * Return the name of the file at the given path:
@@ -163,8 +169,17 @@ cv::Size getImgSize(const CameraMetaInformation& camera_information);
  */
 cv::Point3f fieldToCamera(const cv::Point3f& pos_in_field, const cv::Mat& rvec, const cv::Mat& tvec);
 
+/**
+ * Image position of a field position, throws runtime_error if the point is not valid for correction.
+ * To project several points with the same camera, use CameraModel which avoids converting the parameters for each point
+ */
 cv::Point2f fieldToImg(const cv::Point3f& pos_in_field, const CameraMetaInformation& camera_information);
 
+/**
+ * Return false if the point is too far from the optical axis for the distortion to be monotonic, its projection is then
+ * meaningless. camera_matrix is not used, validity only depends on the position in the camera basis.
+ * See getCorrectionRadius2 to check many points of the same camera
+ */
 bool isPointValidForCorrection(const cv::Point3f& pos, cv::Mat rvec, cv::Mat tvec, cv::Mat camera_matrix,
                                cv::Mat distortion_coeffs);
 
@@ -179,10 +194,20 @@ void protobufToCV(const std::vector<Match2D3DMsg>& matches, std::vector<cv::Poin
 /**
  * Convert from field position to an image position based on camera_information.
  * @return Is the img position valid (for points behind camera, the underlying implementation return image position of
- * the symetric point), if the point is outside of image, then return false as well
+ * the symetric point), if the point is outside of image or if camera_information is not fully specified or supported,
+ * then return false as well
+ * See CameraModel::project to project several points
  */
 bool fieldToImg(const cv::Point3f& pos_in_field, const CameraMetaInformation& camera_information, cv::Point2f* img_pos);
 
+/**
+ * Intersection of the ray seen at img_pos with the horizontal plane at height plane_z, return false if there is none or
+ * if camera_information is not fully specified or supported.
+ * See CameraModel::imgToField to convert several positions, possibly with an undistortion table
+ */
+bool imgToField(const cv::Point2f& img_pos, const CameraMetaInformation& camera_information, cv::Point3f* pos_in_field,
+                double plane_z = 0);
+
 /**
  * Return the time stamp of the given frame, utc or monotonic type is chosen depending on  utc flag
  */
@@ -192,6 +217,7 @@ uint64_t getTS(const FrameEntry& entry, bool utc = true);
  * Returns the index of the frame corresponding to the given time_stamp
  * If no frame has the given time_stamp, return the frame previous to given time_stamp
  * If there is no frame before given time_stamp, returns -1
+ * Cost is O(nb_frames), use FrameIndex to find many frames of the same video
  */
 int getIndex(const VideoMetaInformation& meta_information, uint64_t time_stamp, bool utc = true);
 
@@ -1,8 +1,20 @@
 set (SOURCES
+  camera_model.cpp
+  compression.cpp
+  frame_index.cpp
   game_controller_utils.cpp
+  gc_return_sender.cpp
   labelling_utils.cpp
+  log_merge.cpp
+  log_slice.cpp
+  mapped_message_log.cpp
+  message_log.cpp
   message_manager.cpp
+  perception_in_field.cpp
+  pose_track.cpp
   robot_msg_utils.cpp
+  robot_state.cpp
+  status_cursor.cpp
   udp_broadcast.cpp
   udp_message_manager.cpp
   utils.cpp
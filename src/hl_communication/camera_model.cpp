@@ -0,0 +1,515 @@
+#include <hl_communication/camera_model.h>
+
+#include <hl_communication/utils.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace hl_communication
+{
+/**
+ * Compute the correction radius from the coefficients k1, k2, p1, p2 and k3, missing coefficients are 0
+ */
+static double computeCorrectionRadius2(const std::vector<double>& coeffs)
+{
+  double k1 = coeffs.size() > 0 ? coeffs[0] : 0;
+  double k2 = coeffs.size() > 1 ? coeffs[1] : 0;
+  for (size_t idx = 2; idx < 5 && idx < coeffs.size(); idx++)
+  {
+    // Only purely radial distortions are checked
+    if (coeffs[idx] != 0)
+      return std::numeric_limits<double>::infinity();
+  }
+  double radius2 = std::numeric_limits<double>::infinity();
+  if (k2 == 0)
+  {
+    // Roots of the derivative are +- 1 / sqrt(-3 * k1)
+    if (k1 < 0)
+    {
+      radius2 = 1 / (-3 * k1);
+    }
+    return radius2;
+  }
+  // Roots of 5 * k2 * x^2 + 3 * k1 * x + 1 with x = r^2
+  double a = 5 * k2;
+  double b = 3 * k1;
+  double disc = b * b - 4 * a;
+  if (disc <= 0)
+  {
+    // The sign of the derivative is constant, hence the distortion is monotonic
+    return radius2;
+  }
+  for (double root : { (-b - std::sqrt(disc)) / (2 * a), (-b + std::sqrt(disc)) / (2 * a) })
+  {
+    if (root > 0 && root < radius2)
+    {
+      radius2 = root;
+    }
+  }
+  return radius2;
+}
+
+double getCorrectionRadius2(const IntrinsicParameters& camera_parameters)
+{
+  return computeCorrectionRadius2(
+      std::vector<double>(camera_parameters.distortion().begin(), camera_parameters.distortion().end()));
+}
+
+double getCorrectionRadius2(const cv::Mat& distortion_coeffs)
+{
+  std::vector<double> coeffs;
+  for (int i = 0; i < (int)distortion_coeffs.total(); i++)
+  {
+    coeffs.push_back(distortion_coeffs.at<double>(i));
+  }
+  return computeCorrectionRadius2(coeffs);
+}
+
+/**
+ * Number of iterations used to invert the distortion, see CameraModel::undistortIteratively
+ */
+static constexpr int nb_fixed_point_iterations = 5;
+static constexpr int nb_newton_iterations = 10;
+
+/**
+ * Maximal distance [px] between an image position and the projection of its undistorted position
+ */
+static constexpr double max_undistortion_error = 0.01;
+
+bool isNormalizedValidForCorrection(double x, double y, double correction_radius2)
+{
+  // if the point is close to the center it is valid
+  if (std::fabs(x) < 0.01 && std::fabs(y) < 0.01)
+    return true;
+  return x * x + y * y < correction_radius2;
+}
+
+/**
+ * Rotation matrix from field to camera, conversions are the same as pose3DToCV followed by cv::Rodrigues
+ */
+static Eigen::Matrix3d getRotation(const Pose3D& pose)
+{
+  Eigen::Vector3d rvec;
+  if (pose.rotation_size() == 3)
+  {
+    rvec = Eigen::Vector3d(pose.rotation(0), pose.rotation(1), pose.rotation(2));
+  }
+  else if (pose.rotation_size() == 4)
+  {
+    double qw = pose.rotation(0);
+    Eigen::Vector3d axis(pose.rotation(1), pose.rotation(2), pose.rotation(3));
+    double angle = 2 * acos(qw);
+    double s = std::sqrt(1 - qw * qw);
+    if (s > std::pow(10, -9))
+    {
+      axis /= s;
+    }
+    rvec = axis * angle;
+  }
+  else
+  {
+    throw std::runtime_error("Only Rodrigues rotation vector and quaternions are supported currently");
+  }
+  double angle = rvec.norm();
+  if (angle < std::numeric_limits<double>::epsilon())
+  {
+    return Eigen::Matrix3d::Identity();
+  }
+  return Eigen::AngleAxisd(angle, rvec / angle).toRotationMatrix();
+}
+
+/**
+ * Throws runtime_error if camera_information misses intrinsic or extrinsic parameters
+ */
+static const CameraMetaInformation& checkSpecified(const CameraMetaInformation& camera_information)
+{
+  if (!camera_information.has_camera_parameters() || !camera_information.has_pose())
+  {
+    throw std::runtime_error(HL_DEBUG + " camera_information is not fully specified");
+  }
+  return camera_information;
+}
+
+CameraModel::CameraModel(const CameraMetaInformation& camera_information)
+  : CameraModel(checkSpecified(camera_information).camera_parameters(), camera_information.pose())
+{
+}
+
+CameraModel::CameraModel(const IntrinsicParameters& camera_parameters, const Pose3D& pose)
+{
+  rotation = getRotation(pose);
+  if (pose.translation_size() != 3)
+  {
+    throw std::runtime_error("Size of translation in Pose3D is not valid (only 3 is accepted)");
+  }
+  translation = Eigen::Vector3d(pose.translation(0), pose.translation(1), pose.translation(2));
+  camera_in_field = -rotation.transpose() * translation;
+  focal_x = camera_parameters.focal_x();
+  focal_y = camera_parameters.focal_y();
+  center_x = camera_parameters.center_x();
+  center_y = camera_parameters.center_y();
+  img_size = cv::Size(camera_parameters.img_width(), camera_parameters.img_height());
+  int nb_coeffs = camera_parameters.distortion_size();
+  if (nb_coeffs != 0 && nb_coeffs != 4 && nb_coeffs != 5 && nb_coeffs != 8 && nb_coeffs != 12)
+  {
+    throw std::runtime_error(HL_DEBUG + " unsupported number of distortion coefficients: " +
+                             std::to_string(nb_coeffs));
+  }
+  distortion.fill(0);
+  for (int i = 0; i < nb_coeffs; i++)
+  {
+    distortion[i] = camera_parameters.distortion(i);
+  }
+  correction_radius2 = hl_communication::getCorrectionRadius2(camera_parameters);
+}
+
+cv::Size CameraModel::getImgSize() const
+{
+  return img_size;
+}
+
+double CameraModel::getCorrectionRadius2() const
+{
+  return correction_radius2;
+}
+
+cv::Point3f CameraModel::fieldToCamera(const cv::Point3f& pos_in_field) const
+{
+  Eigen::Vector3d pos_in_camera = toCamera(pos_in_field);
+  return cv::Point3f(pos_in_camera.x(), pos_in_camera.y(), pos_in_camera.z());
+}
+
+Eigen::Vector3d CameraModel::toCamera(const cv::Point3f& pos_in_field) const
+{
+  return rotation * Eigen::Vector3d(pos_in_field.x, pos_in_field.y, pos_in_field.z) + translation;
+}
+
+Eigen::Vector2d CameraModel::getNormalized(const Eigen::Vector3d& pos_in_camera) const
+{
+  double inv_z = pos_in_camera.z() != 0 ? 1 / pos_in_camera.z() : 1;
+  return Eigen::Vector2d(pos_in_camera.x() * inv_z, pos_in_camera.y() * inv_z);
+}
+
+bool CameraModel::isNormalizedValid(const Eigen::Vector2d& normalized) const
+{
+  return isNormalizedValidForCorrection(normalized.x(), normalized.y(), correction_radius2);
+}
+
+cv::Point2f CameraModel::normalizedToImg(const Eigen::Vector2d& normalized) const
+{
+  const std::array<double, 12>& k = distortion;
+  double x = normalized.x();
+  double y = normalized.y();
+  double r2 = x * x + y * y;
+  double r4 = r2 * r2;
+  double r6 = r4 * r2;
+  double a1 = 2 * x * y;
+  double a2 = r2 + 2 * x * x;
+  double a3 = r2 + 2 * y * y;
+  double radial = (1 + k[0] * r2 + k[1] * r4 + k[4] * r6) / (1 + k[5] * r2 + k[6] * r4 + k[7] * r6);
+  double x_distorted = x * radial + k[2] * a1 + k[3] * a2 + k[8] * r2 + k[9] * r4;
+  double y_distorted = y * radial + k[2] * a3 + k[3] * a1 + k[10] * r2 + k[11] * r4;
+  return cv::Point2f(focal_x * x_distorted + center_x, focal_y * y_distorted + center_y);
+}
+
+bool CameraModel::isValidForCorrection(const cv::Point3f& pos_in_field) const
+{
+  return isNormalizedValid(getNormalized(toCamera(pos_in_field)));
+}
+
+cv::Point2f CameraModel::project(const cv::Point3f& pos_in_field) const
+{
+  Eigen::Vector3d pos_in_camera = toCamera(pos_in_field);
+  Eigen::Vector2d normalized = getNormalized(pos_in_camera);
+  if (!isNormalizedValid(normalized))
+  {
+    throw std::runtime_error("The point is too far from the center to be corrected.");
+  }
+  return normalizedToImg(normalized);
+}
+
+bool CameraModel::project(const cv::Point3f& pos_in_field, cv::Point2f* img_pos) const
+{
+  Eigen::Vector3d pos_in_camera = toCamera(pos_in_field);
+  Eigen::Vector2d normalized = getNormalized(pos_in_camera);
+  if (!isNormalizedValid(normalized))
+    return false;
+  *img_pos = normalizedToImg(normalized);
+  // Checking the depth in float as fieldToCamera does
+  return (float)pos_in_camera.z() > 0 && img_pos->x >= 0 && img_pos->y >= 0 && img_pos->x < img_size.width &&
+         img_pos->y < img_size.height;
+}
+
+void CameraModel::getValidityMask(const std::vector<cv::Point3f>& pos_in_field, std::vector<uint8_t>* valid) const
+{
+  valid->resize(pos_in_field.size());
+  for (size_t idx = 0; idx < pos_in_field.size(); idx++)
+  {
+    (*valid)[idx] = isValidForCorrection(pos_in_field[idx]);
+  }
+}
+
+void CameraModel::project(const std::vector<cv::Point3f>& pos_in_field, std::vector<cv::Point2f>* img_pos,
+                          std::vector<uint8_t>* valid) const
+{
+  img_pos->resize(pos_in_field.size());
+  if (valid != nullptr)
+  {
+    valid->resize(pos_in_field.size());
+  }
+  for (size_t idx = 0; idx < pos_in_field.size(); idx++)
+  {
+    bool is_valid = project(pos_in_field[idx], &((*img_pos)[idx]));
+    if (valid != nullptr)
+    {
+      (*valid)[idx] = is_valid;
+    }
+  }
+}
+
+void CameraModel::project(const float* x, const float* y, const float* z, size_t nb_points, float* img_x,
+                          float* img_y, uint8_t* valid) const
+{
+  // Fixed size blocks live on the stack and let Eigen unroll the vectorized loops, the last block is padded
+  constexpr int block_size = 64;
+  typedef Eigen::Array<float, block_size, 1> FloatBlock;
+  typedef Eigen::Array<double, block_size, 1> Block;
+  typedef Eigen::Array<bool, block_size, 1> Mask;
+  const std::array<double, 12>& k = distortion;
+  const Eigen::Matrix3d& r = rotation;
+  const Eigen::Vector3d& t = translation;
+  // The division by the rational part of the distortion is skipped when k4, k5 and k6 are 0 (5 coefficients model)
+  bool rational = k[5] != 0 || k[6] != 0 || k[7] != 0;
+  Block field_x, field_y, field_z;
+  for (size_t start = 0; start < nb_points; start += block_size)
+  {
+    size_t n = std::min<size_t>(block_size, nb_points - start);
+    if (n == block_size)
+    {
+      field_x = Eigen::Map<const FloatBlock>(x + start).cast<double>();
+      field_y = Eigen::Map<const FloatBlock>(y + start).cast<double>();
+      field_z = Eigen::Map<const FloatBlock>(z + start).cast<double>();
+    }
+    else
+    {
+      field_x.setZero();
+      field_y.setZero();
+      field_z.setZero();
+      for (size_t i = 0; i < n; i++)
+      {
+        field_x(i) = x[start + i];
+        field_y(i) = y[start + i];
+        field_z(i) = z[start + i];
+      }
+    }
+    Block camera_z = r(2, 0) * field_x + r(2, 1) * field_y + r(2, 2) * field_z + t(2);
+    Block inv_z = (camera_z != 0).select(camera_z.inverse(), 1.0);
+    Block nx = (r(0, 0) * field_x + r(0, 1) * field_y + r(0, 2) * field_z + t(0)) * inv_z;
+    Block ny = (r(1, 0) * field_x + r(1, 1) * field_y + r(1, 2) * field_z + t(1)) * inv_z;
+    Block r2 = nx.square() + ny.square();
+    Block r4 = r2.square();
+    Block r6 = r4 * r2;
+    Block a1 = 2 * nx * ny;
+    Block radial = 1 + k[0] * r2 + k[1] * r4 + k[4] * r6;
+    if (rational)
+    {
+      radial /= 1 + k[5] * r2 + k[6] * r4 + k[7] * r6;
+    }
+    FloatBlock u =
+        (focal_x * (nx * radial + k[2] * a1 + k[3] * (r2 + 2 * nx.square()) + k[8] * r2 + k[9] * r4) + center_x)
+            .cast<float>();
+    FloatBlock v =
+        (focal_y * (ny * radial + k[2] * (r2 + 2 * ny.square()) + k[3] * a1 + k[10] * r2 + k[11] * r4) + center_y)
+            .cast<float>();
+    // Same conditions as isNormalizedValidForCorrection and project(pos_in_field, img_pos)
+    Mask is_valid = ((nx.abs() < 0.01) && (ny.abs() < 0.01)) || (r2 < correction_radius2);
+    is_valid = is_valid && (camera_z.cast<float>() > 0) && (u >= 0) && (v >= 0) && (u < (float)img_size.width) &&
+               (v < (float)img_size.height);
+    for (size_t i = 0; i < n; i++)
+    {
+      img_x[start + i] = u(i);
+      img_y[start + i] = v(i);
+      valid[start + i] = is_valid(i);
+    }
+  }
+}
+
+Eigen::Vector2d CameraModel::distort(const Eigen::Vector2d& normalized, Eigen::Matrix2d* jacobian) const
+{
+  const std::array<double, 12>& k = distortion;
+  double x = normalized.x();
+  double y = normalized.y();
+  double r2 = x * x + y * y;
+  double num = 1 + ((k[4] * r2 + k[1]) * r2 + k[0]) * r2;
+  double den = 1 + ((k[7] * r2 + k[6]) * r2 + k[5]) * r2;
+  double radial = num / den;
+  // Derivatives with respect to r2
+  double d_num = (3 * k[4] * r2 + 2 * k[1]) * r2 + k[0];
+  double d_den = (3 * k[7] * r2 + 2 * k[6]) * r2 + k[5];
+  double d_radial = (d_num * den - num * d_den) / (den * den);
+  double d_prism_x = k[8] + 2 * k[9] * r2;
+  double d_prism_y = k[10] + 2 * k[11] * r2;
+  (*jacobian)(0, 0) = radial + 2 * x * x * d_radial + 2 * k[2] * y + 6 * k[3] * x + 2 * x * d_prism_x;
+  (*jacobian)(0, 1) = 2 * x * y * d_radial + 2 * k[2] * x + 2 * k[3] * y + 2 * y * d_prism_x;
+  (*jacobian)(1, 0) = 2 * x * y * d_radial + 2 * k[2] * x + 2 * k[3] * y + 2 * x * d_prism_y;
+  (*jacobian)(1, 1) = radial + 2 * y * y * d_radial + 6 * k[2] * y + 2 * k[3] * x + 2 * y * d_prism_y;
+  return Eigen::Vector2d(x * radial + 2 * k[2] * x * y + k[3] * (r2 + 2 * x * x) + (k[8] + k[9] * r2) * r2,
+                         y * radial + k[2] * (r2 + 2 * y * y) + 2 * k[3] * x * y + (k[10] + k[11] * r2) * r2);
+}
+
+bool CameraModel::undistortIteratively(const cv::Point2f& img_pos, Eigen::Vector2d* normalized) const
+{
+  const std::array<double, 12>& k = distortion;
+  Eigen::Vector2d target((img_pos.x - center_x) / focal_x, (img_pos.y - center_y) / focal_y);
+  double x = normalized->x();
+  double y = normalized->y();
+  // Fixed point iterations of cv::undistortPoints are robust far from the solution but converge slowly where the
+  // distortion is strong, they only provide the starting point of Newton iterations
+  for (int iteration = 0; iteration < nb_fixed_point_iterations; iteration++)
+  {
+    double r2 = x * x + y * y;
+    double inv_radial = (1 + ((k[7] * r2 + k[6]) * r2 + k[5]) * r2) / (1 + ((k[4] * r2 + k[1]) * r2 + k[0]) * r2);
+    if (inv_radial < 0)
+      return false;
+    double delta_x = 2 * k[2] * x * y + k[3] * (r2 + 2 * x * x) + k[8] * r2 + k[9] * r2 * r2;
+    double delta_y = k[2] * (r2 + 2 * y * y) + 2 * k[3] * x * y + k[10] * r2 + k[11] * r2 * r2;
+    x = (target.x() - delta_x) * inv_radial;
+    y = (target.y() - delta_y) * inv_radial;
+  }
+  *normalized = Eigen::Vector2d(x, y);
+  for (int iteration = 0; iteration < nb_newton_iterations; iteration++)
+  {
+    Eigen::Matrix2d jacobian;
+    Eigen::Vector2d error = distort(*normalized, &jacobian) - target;
+    if (error.norm() < 1e-12)
+      break;
+    *normalized -= jacobian.inverse() * error;
+  }
+  if (!normalized->allFinite() || !isNormalizedValid(*normalized))
+    return false;
+  cv::Point2f reprojected = normalizedToImg(*normalized);
+  return std::hypot(reprojected.x - img_pos.x, reprojected.y - img_pos.y) < max_undistortion_error;
+}
+
+bool CameraModel::interpolateUndistortion(const cv::Point2f& img_pos, Eigen::Vector2d* normalized) const
+{
+  int width = img_size.width;
+  int height = img_size.height;
+  // Negated comparisons also reject NaN positions
+  if (!(img_pos.x >= 0 && img_pos.y >= 0 && img_pos.x <= width - 1 && img_pos.y <= height - 1))
+    return false;
+  int x = std::min((int)img_pos.x, width - 2);
+  int y = std::min((int)img_pos.y, height - 2);
+  double dx = img_pos.x - x;
+  double dy = img_pos.y - y;
+  const cv::Point2f* row = undistortion_table.data() + y * width + x;
+  const cv::Point2f& p00 = row[0];
+  const cv::Point2f& p10 = row[1];
+  const cv::Point2f& p01 = row[width];
+  const cv::Point2f& p11 = row[width + 1];
+  if (std::isnan(p00.x) || std::isnan(p10.x) || std::isnan(p01.x) || std::isnan(p11.x))
+    return false;
+  double w00 = (1 - dx) * (1 - dy);
+  double w10 = dx * (1 - dy);
+  double w01 = (1 - dx) * dy;
+  double w11 = dx * dy;
+  *normalized = Eigen::Vector2d(w00 * p00.x + w10 * p10.x + w01 * p01.x + w11 * p11.x,
+                                w00 * p00.y + w10 * p10.y + w01 * p01.y + w11 * p11.y);
+  return true;
+}
+
+bool CameraModel::imgToNormalized(const cv::Point2f& img_pos, Eigen::Vector2d* normalized) const
+{
+  if (!undistortion_table.empty() && interpolateUndistortion(img_pos, normalized))
+  {
+    // Interpolation is inaccurate where the distortion is strong, iterations then start from the interpolated position
+    cv::Point2f reprojected = normalizedToImg(*normalized);
+    if (std::hypot(reprojected.x - img_pos.x, reprojected.y - img_pos.y) < max_undistortion_error)
+      return true;
+  }
+  else
+  {
+    *normalized = Eigen::Vector2d((img_pos.x - center_x) / focal_x, (img_pos.y - center_y) / focal_y);
+  }
+  return undistortIteratively(img_pos, normalized);
+}
+
+bool CameraModel::undistort(const cv::Point2f& img_pos, cv::Point2f* normalized) const
+{
+  Eigen::Vector2d result;
+  if (!imgToNormalized(img_pos, &result))
+    return false;
+  *normalized = cv::Point2f(result.x(), result.y());
+  return true;
+}
+
+bool CameraModel::imgToField(const cv::Point2f& img_pos, cv::Point3f* pos_in_field, double plane_z) const
+{
+  Eigen::Vector2d normalized;
+  if (!imgToNormalized(img_pos, &normalized))
+    return false;
+  Eigen::Vector3d dir_in_field = rotation.transpose() * Eigen::Vector3d(normalized.x(), normalized.y(), 1);
+  if (std::fabs(dir_in_field.z()) < std::numeric_limits<double>::epsilon())
+    return false;
+  double dist = (plane_z - camera_in_field.z()) / dir_in_field.z();
+  if (dist <= 0)
+    return false;
+  Eigen::Vector3d pos = camera_in_field + dist * dir_in_field;
+  *pos_in_field = cv::Point3f(pos.x(), pos.y(), pos.z());
+  return true;
+}
+
+void CameraModel::imgToField(const std::vector<cv::Point2f>& img_pos, std::vector<cv::Point3f>* pos_in_field,
+                             std::vector<uint8_t>* valid, double plane_z) const
+{
+  pos_in_field->resize(img_pos.size());
+  if (valid != nullptr)
+  {
+    valid->resize(img_pos.size());
+  }
+  for (size_t idx = 0; idx < img_pos.size(); idx++)
+  {
+    bool is_valid = imgToField(img_pos[idx], &((*pos_in_field)[idx]), plane_z);
+    if (valid != nullptr)
+    {
+      (*valid)[idx] = is_valid;
+    }
+  }
+}
+
+void CameraModel::buildUndistortionTable()
+{
+  if (img_size.width < 2 || img_size.height < 2)
+  {
+    throw std::runtime_error(HL_DEBUG + " invalid image size for the undistortion table: " +
+                             std::to_string(img_size.width) + "x" + std::to_string(img_size.height));
+  }
+  std::vector<cv::Point2f> table(img_size.area());
+  float nan = std::numeric_limits<float>::quiet_NaN();
+  for (int y = 0; y < img_size.height; y++)
+  {
+    for (int x = 0; x < img_size.width; x++)
+    {
+      Eigen::Vector2d normalized((x - center_x) / focal_x, (y - center_y) / focal_y);
+      cv::Point2f& entry = table[y * img_size.width + x];
+      if (undistortIteratively(cv::Point2f(x, y), &normalized))
+      {
+        entry = cv::Point2f(normalized.x(), normalized.y());
+      }
+      else
+      {
+        entry = cv::Point2f(nan, nan);
+      }
+    }
+  }
+  undistortion_table = std::move(table);
+}
+
+bool CameraModel::hasUndistortionTable() const
+{
+  return !undistortion_table.empty();
+}
+
+}  // namespace hl_communication
@@ -0,0 +1,274 @@
+#include <hl_communication/compression.h>
+#include <hl_communication/utils.h>
+
+#include <google/protobuf/io/gzip_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <vector>
+
+using google::protobuf::io::ArrayInputStream;
+using google::protobuf::io::GzipInputStream;
+using google::protobuf::io::GzipOutputStream;
+using google::protobuf::io::StringOutputStream;
+
+namespace hl_communication
+{
+static const char compression_magic[COMPRESSION_HEADER_SIZE] = { 'H', 'L', 'G', 'Z' };
+static const size_t magic_size = COMPRESSION_HEADER_SIZE;
+
+/**
+ * Compressed size and uncompressed size
+ */
+static const size_t block_header_size = COMPRESSED_BLOCK_HEADER_SIZE;
+
+/**
+ * Location of a block inside a compressed container and of its content in the uncompressed data
+ */
+struct CompressedBlock
+{
+  size_t offset;
+  size_t compressed_size;
+  size_t uncompressed_offset;
+  size_t uncompressed_size;
+};
+
+static void writeUint32(uint32_t value, char* dst)
+{
+  for (int byte = 0; byte < 4; byte++)
+  {
+    dst[byte] = (char)(value >> (8 * byte));
+  }
+}
+
+static uint32_t readUint32(const char* src)
+{
+  uint32_t value = 0;
+  for (int byte = 0; byte < 4; byte++)
+  {
+    value |= (uint32_t)(uint8_t)src[byte] << (8 * byte);
+  }
+  return value;
+}
+
+/**
+ * Call 'task' for all indices in [0, nb_tasks[, indices are split in contiguous chunks among 'nb_threads' threads.
+ * Returns false if one of the calls returned false
+ */
+static bool runInParallel(size_t nb_tasks, int nb_threads, const std::function<bool(size_t)>& task)
+{
+  if (nb_threads <= 0)
+  {
+    nb_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  nb_threads = std::max(1, (int)std::min((size_t)nb_threads, nb_tasks));
+  size_t chunk_size = (nb_tasks + nb_threads - 1) / nb_threads;
+  std::vector<char> chunk_failed(nb_threads, false);
+  std::vector<std::thread> threads;
+  for (int thread_idx = 0; thread_idx < nb_threads; thread_idx++)
+  {
+    size_t start = std::min(nb_tasks, thread_idx * chunk_size);
+    size_t end = std::min(nb_tasks, start + chunk_size);
+    threads.emplace_back([&, thread_idx, start, end]() {
+      for (size_t idx = start; idx < end; idx++)
+      {
+        if (!task(idx))
+        {
+          chunk_failed[thread_idx] = true;
+          return;
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+  return std::find(chunk_failed.begin(), chunk_failed.end(), true) == chunk_failed.end();
+}
+
+/**
+ * Decompress a gzip stream into 'dst' which has exactly the expected size
+ */
+static bool decompressBlock(const char* data, size_t size, char* dst, size_t dst_size)
+{
+  ArrayInputStream array_stream(data, size);
+  GzipInputStream gzip_stream(&array_stream, GzipInputStream::GZIP);
+  size_t written = 0;
+  const void* chunk;
+  int chunk_size;
+  while (gzip_stream.Next(&chunk, &chunk_size))
+  {
+    if ((size_t)chunk_size > dst_size - written)
+      return false;
+    memcpy(dst + written, chunk, chunk_size);
+    written += chunk_size;
+  }
+  return gzip_stream.ZlibErrorCode() >= 0 && written == dst_size;
+}
+
+bool isCompressed(const char* data, size_t size)
+{
+  return size >= magic_size && memcmp(data, compression_magic, magic_size) == 0;
+}
+
+bool isCompressedFile(const std::string& path)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in.good())
+  {
+    throw std::runtime_error(HL_DEBUG + "failed to open file '" + path + "'");
+  }
+  char magic[magic_size];
+  in.read(magic, magic_size);
+  return isCompressed(magic, in.gcount());
+}
+
+void appendCompressionHeader(std::string* buffer)
+{
+  buffer->append(compression_magic, magic_size);
+}
+
+void appendCompressedBlock(const char* data, size_t size, std::string* buffer)
+{
+  if (size > MAX_COMPRESSED_BLOCK_SIZE)
+  {
+    throw std::logic_error(HL_DEBUG + "block is too large: " + std::to_string(size) + " bytes");
+  }
+  size_t header_offset = buffer->size();
+  buffer->append(block_header_size, '\0');
+  {
+    StringOutputStream string_stream(buffer);
+    GzipOutputStream::Options options;
+    options.format = GzipOutputStream::GZIP;
+    GzipOutputStream gzip_stream(&string_stream, options);
+    size_t read = 0;
+    void* chunk;
+    int chunk_size;
+    while (read < size)
+    {
+      if (!gzip_stream.Next(&chunk, &chunk_size))
+      {
+        throw std::runtime_error(HL_DEBUG + "compression failed: " + gzip_stream.ZlibErrorMessage());
+      }
+      size_t copied = std::min((size_t)chunk_size, size - read);
+      memcpy(chunk, data + read, copied);
+      read += copied;
+      if (copied < (size_t)chunk_size)
+      {
+        gzip_stream.BackUp(chunk_size - copied);
+      }
+    }
+    if (!gzip_stream.Close())
+    {
+      throw std::runtime_error(HL_DEBUG + "compression failed: " + gzip_stream.ZlibErrorMessage());
+    }
+  }
+  size_t compressed_size = buffer->size() - header_offset - block_header_size;
+  writeUint32(compressed_size, &(*buffer)[header_offset]);
+  writeUint32(size, &(*buffer)[header_offset + 4]);
+}
+
+void readCompressedBlockHeader(const char* data, size_t* compressed_size, size_t* uncompressed_size)
+{
+  *compressed_size = readUint32(data);
+  *uncompressed_size = readUint32(data + 4);
+  // Incompressible data grows by less than 0.1% plus the gzip header, deflate can't compress by more than 1032:1
+  if (*uncompressed_size > MAX_COMPRESSED_BLOCK_SIZE ||
+      *compressed_size > *uncompressed_size + *uncompressed_size / 1000 + 1024 ||
+      *uncompressed_size > *compressed_size * 1032 + 1024)
+  {
+    throw std::runtime_error(HL_DEBUG + "malformed compressed block header: " + std::to_string(*compressed_size) +
+                             " compressed bytes for " + std::to_string(*uncompressed_size) + " bytes");
+  }
+}
+
+void appendDecompressedBlock(const char* data, size_t size, size_t uncompressed_size, std::string* buffer)
+{
+  size_t offset = buffer->size();
+  buffer->resize(offset + uncompressed_size);
+  if (!decompressBlock(data, size, &(*buffer)[offset], uncompressed_size))
+  {
+    buffer->resize(offset);
+    throw std::runtime_error(HL_DEBUG + "corrupted compressed block");
+  }
+}
+
+void compress(const char* data, size_t size, std::string* out, size_t block_size, int nb_threads)
+{
+  if (block_size == 0 || block_size > MAX_COMPRESSED_BLOCK_SIZE)
+  {
+    throw std::logic_error(HL_DEBUG + "invalid block_size: " + std::to_string(block_size));
+  }
+  size_t nb_blocks = (size + block_size - 1) / block_size;
+  std::vector<std::string> blocks(nb_blocks);
+  bool success = runInParallel(nb_blocks, nb_threads, [&](size_t idx) {
+    size_t offset = idx * block_size;
+    try
+    {
+      appendCompressedBlock(data + offset, std::min(block_size, size - offset), &blocks[idx]);
+    }
+    catch (const std::runtime_error&)
+    {
+      return false;
+    }
+    return true;
+  });
+  if (!success)
+  {
+    throw std::runtime_error(HL_DEBUG + "compression failed");
+  }
+  out->clear();
+  appendCompressionHeader(out);
+  for (const std::string& block : blocks)
+  {
+    out->append(block);
+  }
+}
+
+size_t decompress(const char* data, size_t size, std::string* out, int nb_threads, size_t max_size)
+{
+  if (!isCompressed(data, size))
+  {
+    throw std::runtime_error(HL_DEBUG + "data is not a compressed container");
+  }
+  // Blocks are located using their headers only, then decompressed in parallel
+  std::vector<CompressedBlock> blocks;
+  size_t pos = magic_size;
+  size_t total_size = 0;
+  while (size - pos >= block_header_size)
+  {
+    CompressedBlock block;
+    block.offset = pos + block_header_size;
+    block.uncompressed_offset = total_size;
+    readCompressedBlockHeader(data + pos, &block.compressed_size, &block.uncompressed_size);
+    if (block.compressed_size > size - block.offset)
+      break;
+    if (block.uncompressed_size > max_size - total_size)
+    {
+      throw std::runtime_error(HL_DEBUG + "content of the compressed container is larger than " +
+                               std::to_string(max_size) + " bytes");
+    }
+    blocks.push_back(block);
+    pos = block.offset + block.compressed_size;
+    total_size += block.uncompressed_size;
+  }
+  out->clear();
+  out->resize(total_size);
+  bool success = runInParallel(blocks.size(), nb_threads, [&](size_t idx) {
+    const CompressedBlock& block = blocks[idx];
+    return decompressBlock(data + block.offset, block.compressed_size, &(*out)[block.uncompressed_offset],
+                           block.uncompressed_size);
+  });
+  if (!success)
+  {
+    throw std::runtime_error(HL_DEBUG + "corrupted compressed block");
+  }
+  return pos;
+}
+
+}  // namespace hl_communication
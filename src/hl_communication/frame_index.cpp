@@ -0,0 +1,164 @@
+#include <hl_communication/frame_index.h>
+
+#include <hl_communication/utils.h>
+
+#include <algorithm>
+
+namespace hl_communication
+{
+FrameIndex::FrameIndex(const VideoMetaInformation& meta_information) : nb_frames(meta_information.frames_size())
+{
+  for (bool utc : { true, false })
+  {
+    Clock* clock = utc ? &utc_clock : &monotonic_clock;
+    clock->nb_leading = -1;
+    for (int index = 0; index < nb_frames; index++)
+    {
+      const FrameEntry& frame = meta_information.frames(index);
+      bool available = utc ? frame.has_utc_ts() : frame.has_monotonic_ts();
+      clock->time_stamps.push_back(available ? getTS(frame, utc) : 0);
+      clock->available.push_back(available);
+      if (!available && clock->nb_leading < 0)
+      {
+        clock->nb_leading = index;
+      }
+    }
+    if (clock->nb_leading < 0)
+    {
+      clock->nb_leading = nb_frames;
+    }
+    clock->sorted = std::is_sorted(clock->time_stamps.begin(), clock->time_stamps.begin() + clock->nb_leading);
+    if (clock->sorted)
+    {
+      buildSegments(clock);
+    }
+  }
+}
+
+void FrameIndex::buildSegments(Clock* clock)
+{
+  const std::vector<uint64_t>& time_stamps = clock->time_stamps;
+  int nb_leading = clock->nb_leading;
+  int begin = 0;
+  while (begin < nb_leading)
+  {
+    int end = begin + 1;
+    if (end < nb_leading)
+    {
+      uint64_t interval = time_stamps[end] - time_stamps[begin];
+      // A segment ends when an interval differs from the first one by more than half of it (e.g. dropped frames)
+      while (end < nb_leading)
+      {
+        uint64_t current = time_stamps[end] - time_stamps[end - 1];
+        uint64_t diff = current > interval ? current - interval : interval - current;
+        if (2 * diff > interval)
+          break;
+        end++;
+      }
+    }
+    Segment segment;
+    segment.begin = begin;
+    segment.end = end;
+    segment.start_ts = time_stamps[begin];
+    segment.period = end - begin > 1 ? (time_stamps[end - 1] - time_stamps[begin]) / (double)(end - 1 - begin) : 0;
+    clock->segments.push_back(segment);
+    begin = end;
+  }
+}
+
+int FrameIndex::lowerBound(const Clock& clock, uint64_t time_stamp) const
+{
+  const std::vector<uint64_t>& time_stamps = clock.time_stamps;
+  int nb_leading = clock.nb_leading;
+  if (nb_leading == 0 || time_stamp <= time_stamps[0])
+    return 0;
+  if (time_stamp > time_stamps[nb_leading - 1])
+    return nb_leading;
+  // From here: time_stamps[0] < time_stamp <= time_stamps[nb_leading - 1]
+  auto segment_it = std::upper_bound(clock.segments.begin(), clock.segments.end(), time_stamp,
+                                     [](uint64_t ts, const Segment& segment) { return ts < segment.start_ts; });
+  const Segment& segment = *std::prev(segment_it);
+  int guess = segment.begin;
+  if (segment.period > 0)
+  {
+    double offset = (time_stamp - segment.start_ts) / segment.period;
+    guess += (int)std::min(offset, (double)(segment.end - 1 - segment.begin));
+  }
+  // Exponential search around the guess for low and high such as: time_stamps[low] < time_stamp <= time_stamps[high]
+  int low, high;
+  int step = 1;
+  if (time_stamps[guess] < time_stamp)
+  {
+    low = guess;
+    high = guess + 1;
+    while (high < nb_leading - 1 && time_stamps[high] < time_stamp)
+    {
+      low = high;
+      high = std::min(nb_leading - 1, high + step);
+      step *= 2;
+    }
+  }
+  else
+  {
+    high = guess;
+    low = guess - 1;
+    while (low > 0 && time_stamps[low] >= time_stamp)
+    {
+      high = low;
+      low = std::max(0, low - step);
+      step *= 2;
+    }
+  }
+  return std::lower_bound(time_stamps.begin() + low + 1, time_stamps.begin() + high + 1, time_stamp) -
+         time_stamps.begin();
+}
+
+void FrameIndex::checkAvailable(const Clock& clock, int index, bool utc) const
+{
+  if (!clock.available[index])
+  {
+    throw std::logic_error(HL_DEBUG + " no " + (utc ? "utc" : "monotonic") + " ts available for frame " +
+                           std::to_string(index));
+  }
+}
+
+int FrameIndex::getNbFrames() const
+{
+  return nb_frames;
+}
+
+int FrameIndex::getIndex(uint64_t time_stamp, bool utc) const
+{
+  const Clock& clock = utc ? utc_clock : monotonic_clock;
+  const std::vector<uint64_t>& time_stamps = clock.time_stamps;
+  int nb_leading = clock.nb_leading;
+  int index = 0;
+  if (clock.sorted)
+  {
+    index = lowerBound(clock, time_stamp);
+  }
+  else
+  {
+    while (index < nb_leading && time_stamps[index] < time_stamp)
+    {
+      index++;
+    }
+  }
+  if (index == nb_frames)
+    return nb_frames - 1;
+  // Frame at index is the first one which misses the time stamp if index is nb_leading, getIndex throws as well
+  checkAvailable(clock, index, utc);
+  return time_stamps[index] == time_stamp ? index : index - 1;
+}
+
+uint64_t FrameIndex::getTimeStamp(int index, bool utc) const
+{
+  if (nb_frames <= index || index < 0)
+    throw std::out_of_range(HL_DEBUG + " invalid index: " + std::to_string(index) +
+                            " (nb frames: " + std::to_string(nb_frames) + ")");
+  const Clock& clock = utc ? utc_clock : monotonic_clock;
+  checkAvailable(clock, index, utc);
+  return clock.time_stamps[index];
+}
+
+}  // namespace hl_communication
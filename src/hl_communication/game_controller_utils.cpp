@@ -1,14 +1,67 @@
 #include <hl_communication/game_controller_utils.h>
+#include <hl_communication/utils.h>
 
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 namespace hl_communication
 {
-static const int nb_chars_by_robot = 4;
-static const int nb_chars_by_team = 260 + nb_chars_by_robot * 12;
-static const int protocol_version = 12;
 static const char* game_state_header = "RGme";
 
+static const char* return_header = "RGrt";
+
+static constexpr int return_version = 2;
+
+static constexpr size_t return_packet_size = 8;
+
+static constexpr int nb_teams = 2;
+
+/**
+ * Version 12, robots are described by penalty, secs_till_unpenalised, yellow_card_count and red_card_count
+ */
+static constexpr GCLayout gc_layout_v12 = {
+  12,                                                                    // version
+  24 + nb_teams * 308,                                                   // packet_size
+  { 4, 2 },   { 7, 1 },   { 8, 1 },   { 9, 1 },   { 10, 1 }, { 11, 1 },  // struct_version .. kick_off_team
+  { 12, 1 },  { 13, 1 },  { 14, 1 },  { 17, 1 },  { 18, 2 }, { 20, 2 },  // sec_game_state .. estimated_secs
+  { 22, 2 },                                                             // secondary_secs
+  24,         308,        { 0, 1 },   { 1, 1 },   { 2, 1 },              // teams
+  6,          264,        4,                                             // robots
+  { 0, 1 },   { 1, 1 },   { 2, 1 },   { 3, 1 },                          // robot fields
+};
+
+/**
+ * Version 12 with number_of_warnings and goal_keeper added to the description of robots (not exported)
+ */
+static constexpr GCLayout gc_layout_v12_warnings = {
+  12,                                                                    // version
+  24 + nb_teams * 332,                                                   // packet_size
+  { 4, 2 },   { 7, 1 },   { 8, 1 },   { 9, 1 },   { 10, 1 }, { 11, 1 },  // struct_version .. kick_off_team
+  { 12, 1 },  { 13, 1 },  { 14, 1 },  { 17, 1 },  { 18, 2 }, { 20, 2 },  // sec_game_state .. estimated_secs
+  { 22, 2 },                                                             // secondary_secs
+  24,         332,        { 0, 1 },   { 1, 1 },   { 2, 1 },              // teams
+  6,          266,        6,                                             // robots
+  { 0, 1 },   { 1, 1 },   { 3, 1 },   { 4, 1 },                          // robot fields
+};
+
+/**
+ * Version and header are located at the same place in all the layouts
+ */
+static constexpr GCField gc_version_field = { 4, 2 };
+
+/**
+ * Read a field with fixed-width loads, values are signed as with charsToInt
+ */
+static inline int readField(char const* data, const GCField& field)
+{
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data + field.offset);
+  if (field.size == 1)
+    return (int8_t)bytes[0];
+  return (int16_t)(bytes[0] | (bytes[1] << 8));
+}
+
 int getGCDefaultPort()
 {
   return 3838;
@@ -41,6 +94,156 @@ int charsToInt(char const* str, int start, int end)
   return sum;
 }
 
+size_t getGCPacketSize()
+{
+  return gc_layout_v12.packet_size;
+}
+
+bool isGCPacket(char const* data, size_t size)
+{
+  return size >= 4 && strncmp(data, game_state_header, 4) == 0;
+}
+
+/**
+ * Decode a packet with a valid header and matching 'layout', offsets are known at compile time
+ */
+template <const GCLayout& layout>
+static void decodeWithLayout(char const* data, GCMsg* msg)
+{
+  msg->set_struct_version(readField(data, layout.struct_version));
+  msg->set_game_type(readField(data, layout.game_type));
+  msg->set_num_player(readField(data, layout.num_player));
+  msg->set_first_half(readField(data, layout.first_half));
+  msg->set_kick_off_team(readField(data, layout.kick_off_team));
+  msg->set_sec_game_state(readField(data, layout.sec_game_state));
+  msg->set_drop_in_team(readField(data, layout.drop_in_team));
+  msg->set_drop_in_time(readField(data, layout.drop_in_time));
+  msg->set_estimated_secs(readField(data, layout.estimated_secs));
+  msg->set_secondary_secs(readField(data, layout.secondary_secs));
+  msg->set_secondary_mode(readField(data, layout.secondary_mode));
+  // Not exported by GameState::exportToGCMsg
+  msg->clear_secondary_team();
+  if (msg->teams_size() != nb_teams)
+  {
+    // Cleared elements are kept by the repeated field and reused by add_teams
+    msg->clear_teams();
+    for (int team = 0; team < nb_teams; team++)
+    {
+      msg->add_teams();
+    }
+  }
+  for (int team = 0; team < nb_teams; team++)
+  {
+    char const* team_data = data + layout.teams_offset + team * layout.team_size;
+    GCTeamMsg* team_msg = msg->mutable_teams(team);
+    team_msg->set_team_number(readField(team_data, layout.team_number));
+    team_msg->set_team_color(readField(team_data, layout.team_color));
+    team_msg->set_score(readField(team_data, layout.score));
+    if (team_msg->robots_size() != layout.nb_robots)
+    {
+      team_msg->clear_robots();
+      for (int robot = 0; robot < layout.nb_robots; robot++)
+      {
+        team_msg->add_robots();
+      }
+    }
+    for (int robot = 0; robot < layout.nb_robots; robot++)
+    {
+      char const* robot_data = team_data + layout.robots_offset + robot * layout.robot_size;
+      GCRobotMsg* robot_msg = team_msg->mutable_robots(robot);
+      robot_msg->set_penalty(readField(robot_data, layout.penalty));
+      robot_msg->set_secs_till_unpenalised(readField(robot_data, layout.secs_till_unpenalised));
+      robot_msg->set_yellow_card_count(readField(robot_data, layout.yellow_card_count));
+      robot_msg->set_red_card_count(readField(robot_data, layout.red_card_count));
+    }
+  }
+}
+
+/**
+ * A supported layout and its decoder
+ */
+class GCDecoder
+{
+public:
+  const GCLayout* layout;
+  void (*decode)(char const* data, GCMsg* msg);
+};
+
+/**
+ * Supported layouts, the first layout of a version is its default one
+ */
+static constexpr GCDecoder gc_decoders[] = {
+  { &gc_layout_v12, decodeWithLayout<gc_layout_v12> },
+  { &gc_layout_v12_warnings, decodeWithLayout<gc_layout_v12_warnings> },
+};
+
+/**
+ * Return the decoder of the packet, nullptr if it is not supported
+ */
+static const GCDecoder* findDecoder(int struct_version, size_t packet_size)
+{
+  for (const GCDecoder& decoder : gc_decoders)
+  {
+    if (decoder.layout->version == struct_version && decoder.layout->packet_size == packet_size)
+      return &decoder;
+  }
+  return nullptr;
+}
+
+const GCLayout* getGCLayout(int struct_version, size_t packet_size)
+{
+  const GCDecoder* decoder = findDecoder(struct_version, packet_size);
+  return decoder != nullptr ? decoder->layout : nullptr;
+}
+
+const GCLayout* getGCLayout(int struct_version)
+{
+  for (const GCDecoder& decoder : gc_decoders)
+  {
+    if (decoder.layout->version == struct_version)
+      return decoder.layout;
+  }
+  return nullptr;
+}
+
+bool decodeGCPacket(char const* data, size_t size, GCMsg* msg)
+{
+  if (size < gc_version_field.offset + gc_version_field.size || !isGCPacket(data, size))
+    return false;
+  const GCDecoder* decoder = findDecoder(readField(data, gc_version_field), size);
+  if (decoder == nullptr)
+    return false;
+  decoder->decode(data, msg);
+  return true;
+}
+
+int getGCReturnPort()
+{
+  return 3939;
+}
+
+size_t getGCReturnPacketSize()
+{
+  return return_packet_size;
+}
+
+bool encodeGCReturnPacket(int team_id, int robot_id, GCReturnMessage message, char* data, size_t size)
+{
+  if (team_id < 0 || team_id > 255 || robot_id < 0 || robot_id > 255)
+  {
+    throw std::out_of_range(HL_DEBUG + "invalid team_id (" + std::to_string(team_id) + ") or robot_id (" +
+                            std::to_string(robot_id) + ")");
+  }
+  if (size < return_packet_size)
+    return false;
+  memcpy(data, return_header, 4);
+  data[4] = (char)return_version;
+  data[5] = (char)team_id;
+  data[6] = (char)robot_id;
+  data[7] = (char)message;
+  return true;
+}
+
 Robot::Robot()
 {
   penalty = 0;
@@ -74,11 +277,16 @@ int Robot::getRedCardCount() const
 /* Use a broadcasted message to update the Robot */
 void Robot::updateFromMessage(char const* message, int numRobot)
 {
-  int d = nb_chars_by_robot * numRobot;
-  penalty = charsToInt(message, d + 0, d + 1);
-  secs_till_unpenalised = charsToInt(message, d + 1, d + 2);
-  yellow_card_count = charsToInt(message, d + 2, d + 3);
-  red_card_count = charsToInt(message, d + 3, d + 4);
+  updateFromMessage(message, numRobot, gc_layout_v12);
+}
+
+void Robot::updateFromMessage(char const* message, int numRobot, const GCLayout& layout)
+{
+  char const* robot_data = message + layout.robot_size * numRobot;
+  penalty = readField(robot_data, layout.penalty);
+  secs_till_unpenalised = readField(robot_data, layout.secs_till_unpenalised);
+  yellow_card_count = readField(robot_data, layout.yellow_card_count);
+  red_card_count = readField(robot_data, layout.red_card_count);
 }
 
 void Robot::exportToGCRobotMsg(GCRobotMsg* msg) const
@@ -138,13 +346,18 @@ const Robot& Team::getRobot(int robot) const
 /* Use a broadcasted message to update the Robot */
 void Team::updateFromMessage(char const* message, int numTeam)
 {
-  int d = nb_chars_by_team * numTeam;  // offset
-  team_number = charsToInt(message, d + 0, d + 1);
-  team_color = charsToInt(message, d + 1, d + 2);
-  score = charsToInt(message, d + 2, d + 3);
-  for (int robot = 0; robot < 6; robot++)
+  updateFromMessage(message, numTeam, gc_layout_v12);
+}
+
+void Team::updateFromMessage(char const* message, int numTeam, const GCLayout& layout)
+{
+  char const* team_data = message + layout.team_size * numTeam;
+  team_number = readField(team_data, layout.team_number);
+  team_color = readField(team_data, layout.team_color);
+  score = readField(team_data, layout.score);
+  for (int robot = 0; robot < layout.nb_robots; robot++)
   {
-    robots[robot].updateFromMessage(message + d + 260 + nb_chars_by_robot, robot);
+    robots[robot].updateFromMessage(team_data + layout.robots_offset, robot, layout);
   }
 }
 
@@ -198,31 +411,52 @@ bool GameState::updateFromMessage(char const* message)
   {
     return false;
   }
-  struct_version = charsToInt(message, 4, 6);
-
-  if (struct_version != protocol_version)
+  struct_version = readField(message, gc_version_field);
+  const GCLayout* layout = getGCLayout(struct_version);
+  if (layout == nullptr)
   {
     std::cerr << "Game controller bad version " << struct_version << std::endl;
     return false;
   }
+  updateFromLayout(message, *layout);
+  return true;
+}
+
+bool GameState::updateFromMessage(char const* message, size_t size)
+{
+  if (!isGCPacket(message, size) || size < gc_version_field.offset + gc_version_field.size)
+  {
+    return false;
+  }
+  struct_version = readField(message, gc_version_field);
+  const GCLayout* layout = getGCLayout(struct_version, size);
+  if (layout == nullptr)
+  {
+    std::cerr << "Game controller bad version " << struct_version << " or size " << size << std::endl;
+    return false;
+  }
+  updateFromLayout(message, *layout);
+  return true;
+}
 
-  num_player = charsToInt(message, 7, 8);
-  game_type = charsToInt(message, 8, 9);
-  actual_game_state = charsToInt(message, 9, 10);
-  first_half = charsToInt(message, 10, 11);
-  kick_off_team = charsToInt(message, 11, 12);
-  sec_game_state = charsToInt(message, 12, 13);
-  secondary_team = charsToInt(message, 13, 14);
-  secondary_mode = charsToInt(message, 14, 15);
+void GameState::updateFromLayout(char const* message, const GCLayout& layout)
+{
+  num_player = readField(message, layout.num_player);
+  game_type = readField(message, layout.game_type);
+  actual_game_state = readField(message, layout.game_state);
+  first_half = readField(message, layout.first_half);
+  kick_off_team = readField(message, layout.kick_off_team);
+  sec_game_state = readField(message, layout.sec_game_state);
+  secondary_team = readField(message, layout.secondary_team);
+  secondary_mode = readField(message, layout.secondary_mode);
 
-  drop_in_team = charsToInt(message, 17, 18);
-  drop_in_time = charsToInt(message, 18, 20);
-  estimated_secs = charsToInt(message, 20, 22);
-  secondary_secs = charsToInt(message, 22, 24);
+  drop_in_team = readField(message, layout.drop_in_team);
+  drop_in_time = readField(message, layout.drop_in_time);
+  estimated_secs = readField(message, layout.estimated_secs);
+  secondary_secs = readField(message, layout.secondary_secs);
 
-  for (int i = 0; i < 2; i++)
-    team[i].updateFromMessage(message + 24, i);
-  return true;
+  for (int i = 0; i < nb_teams; i++)
+    team[i].updateFromMessage(message + layout.teams_offset, i, layout);
 }
 
 int GameState::getStructVersion() const
@@ -0,0 +1,118 @@
+#include <hl_communication/gc_return_sender.h>
+
+#include <hl_communication/utils.h>
+
+#include <stdexcept>
+
+namespace hl_communication
+{
+/**
+ * Period corresponding to 'frequency' [Hz], throws logic_error if frequency is not positive
+ */
+static std::chrono::steady_clock::duration getPeriod(double frequency)
+{
+  if (!(frequency > 0))
+  {
+    throw std::logic_error(HL_DEBUG + "frequency should be positive, received: " + std::to_string(frequency));
+  }
+  return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1 / frequency));
+}
+
+GCReturnSender::GCReturnSender(int team_id_, int robot_id_, double frequency_, int port)
+  : team_id(team_id_)
+  , robot_id(robot_id_)
+  , message(GC_RETURN_ALIVE)
+  , nb_packets_sent(0)
+  , frequency(frequency_)
+  , period(getPeriod(frequency_))
+  , continue_to_run(true)
+{
+  // Checks identifiers before opening the socket
+  char packet[8];
+  encodeGCReturnPacket(team_id, robot_id, GC_RETURN_ALIVE, packet, sizeof(packet));
+  broadcaster.reset(new UDPBroadcast(-1, port));
+  next_deadline = Clock::now();
+  thread.reset(new std::thread([this]() { this->run(); }));
+}
+
+GCReturnSender::~GCReturnSender()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    continue_to_run = false;
+  }
+  wake_up.notify_all();
+  thread->join();
+  broadcaster->closeWrite();
+}
+
+void GCReturnSender::setMessage(GCReturnMessage new_message)
+{
+  message = new_message;
+}
+
+void GCReturnSender::setFrequency(double new_frequency)
+{
+  Clock::duration new_period = getPeriod(new_frequency);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    frequency = new_frequency;
+    period = new_period;
+    next_deadline = Clock::now() + period;
+  }
+  wake_up.notify_all();
+}
+
+double GCReturnSender::getFrequency() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return frequency;
+}
+
+void GCReturnSender::sendNow(GCReturnMessage manual_message)
+{
+  send(manual_message);
+}
+
+uint64_t GCReturnSender::getNbPacketsSent() const
+{
+  return nb_packets_sent;
+}
+
+void GCReturnSender::send(GCReturnMessage packet_message)
+{
+  char packet[8];
+  encodeGCReturnPacket(team_id, robot_id, packet_message, packet, sizeof(packet));
+  std::lock_guard<std::mutex> lock(broadcast_mutex);
+  if (broadcaster->broadcastMessage(packet, getGCReturnPacketSize()))
+  {
+    nb_packets_sent++;
+  }
+}
+
+void GCReturnSender::run()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (continue_to_run)
+  {
+    // Deadline may be modified by setFrequency while waiting, it is checked again after each wake up
+    if (Clock::now() < next_deadline)
+    {
+      wake_up.wait_until(lock, next_deadline);
+      continue;
+    }
+    Clock::time_point now = Clock::now();
+    next_deadline += period;
+    if (next_deadline <= now)
+    {
+      // Skip missed packets instead of catching up with a burst
+      next_deadline = now + period;
+    }
+    // The schedule is computed before sending, setFrequency is not blocked by a slow send
+    lock.unlock();
+    send(message);
+    lock.lock();
+  }
+}
+
+}  // namespace hl_communication
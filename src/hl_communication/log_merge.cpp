@@ -0,0 +1,149 @@
+#include <hl_communication/log_merge.h>
+#include <hl_communication/message_log.h>
+#include <hl_communication/utils.h>
+
+#include <deque>
+#include <memory>
+#include <queue>
+#include <set>
+#include <tuple>
+
+namespace hl_communication
+{
+/**
+ * Source ip, source port and packet number
+ */
+typedef std::tuple<uint64_t, uint32_t, uint64_t> MsgKey;
+
+/**
+ * A log being merged and its next message
+ */
+struct MergeInput
+{
+  std::unique_ptr<MessageLogReader> reader;
+  int64_t time_offset;
+  GameMsg msg;
+  uint64_t time_stamp;
+};
+
+LogMergeSettings::LogMergeSettings() : compressed(false), dedup_window(10 * 1000 * 1000)
+{
+}
+
+LogMergeStatistics::LogMergeStatistics() : messages_read(0), messages_written(0), duplicates(0)
+{
+}
+
+/**
+ * Time stamp used to order messages: utc_time_stamp if available, reception time converted to utc otherwise
+ */
+static uint64_t getMergeTimeStamp(const GameMsg& msg, int64_t time_offset)
+{
+  if (msg.has_robot_msg())
+  {
+    const RobotMsg& robot_msg = msg.robot_msg();
+    return robot_msg.has_utc_time_stamp() ? robot_msg.utc_time_stamp() : robot_msg.time_stamp() + time_offset;
+  }
+  if (msg.has_gc_msg())
+  {
+    const GCMsg& gc_msg = msg.gc_msg();
+    return gc_msg.has_utc_time_stamp() ? gc_msg.utc_time_stamp() : gc_msg.time_stamp() + time_offset;
+  }
+  return 0;
+}
+
+/**
+ * Read the next message of 'input', returns false at the end of the log
+ */
+static bool readNext(MergeInput* input, LogMergeStatistics* statistics)
+{
+  if (!input->reader->read(&input->msg))
+    return false;
+  statistics->messages_read++;
+  input->time_stamp = getMergeTimeStamp(input->msg, input->time_offset);
+  return true;
+}
+
+LogMergeStatistics mergeLogs(const std::vector<std::string>& input_paths, const std::string& output_path,
+                             const LogMergeSettings& settings)
+{
+  LogMergeStatistics statistics;
+  std::vector<MergeInput> inputs(input_paths.size());
+  bool has_output_offset = false;
+  int64_t output_offset = 0;
+  for (size_t idx = 0; idx < input_paths.size(); idx++)
+  {
+    // The last time_offset of a streaming log prevails, it is only known once the whole log has been scanned
+    MessageLogReader scanner(input_paths[idx]);
+    while (scanner.read(nullptr))
+    {
+    }
+    inputs[idx].time_offset = scanner.getHeader().time_offset();
+    if (!has_output_offset && scanner.getHeader().has_time_offset())
+    {
+      has_output_offset = true;
+      output_offset = inputs[idx].time_offset;
+    }
+    inputs[idx].reader.reset(new MessageLogReader(input_paths[idx]));
+  }
+
+  // Smallest time stamp first, ties are broken by input order to keep the merge deterministic
+  auto later = [&inputs](size_t idx1, size_t idx2) {
+    return std::tie(inputs[idx1].time_stamp, idx1) > std::tie(inputs[idx2].time_stamp, idx2);
+  };
+  std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heads(later);
+  for (size_t idx = 0; idx < inputs.size(); idx++)
+  {
+    if (readNext(&inputs[idx], &statistics))
+    {
+      heads.push(idx);
+    }
+  }
+
+  OfflineLogWriter writer(output_path, output_offset, settings.compressed);
+
+  // Identifiers of the messages written inside the dedup window, in order of time stamp
+  std::set<MsgKey> recent_keys;
+  std::deque<std::pair<uint64_t, MsgKey>> recent_history;
+  while (!heads.empty())
+  {
+    size_t idx = heads.top();
+    heads.pop();
+    MergeInput& input = inputs[idx];
+    GameMsg& msg = input.msg;
+    while (!recent_history.empty() && recent_history.front().first + settings.dedup_window < input.time_stamp)
+    {
+      recent_keys.erase(recent_history.front().second);
+      recent_history.pop_front();
+    }
+    const MsgIdentifier& identifier = msg.identifier();
+    MsgKey key(identifier.src_ip(), identifier.src_port(), identifier.packet_no());
+    if (recent_keys.insert(key).second)
+    {
+      recent_history.emplace_back(input.time_stamp, key);
+      int64_t shift = input.time_offset - output_offset;
+      if (msg.has_robot_msg() && msg.robot_msg().has_time_stamp())
+      {
+        msg.mutable_robot_msg()->set_time_stamp(msg.robot_msg().time_stamp() + shift);
+      }
+      else if (msg.has_gc_msg() && msg.gc_msg().has_time_stamp())
+      {
+        msg.mutable_gc_msg()->set_time_stamp(msg.gc_msg().time_stamp() + shift);
+      }
+      writer.write(msg);
+      statistics.messages_written++;
+    }
+    else
+    {
+      statistics.duplicates++;
+    }
+    if (readNext(&input, &statistics))
+    {
+      heads.push(idx);
+    }
+  }
+  writer.flush();
+  return statistics;
+}
+
+}  // namespace hl_communication
@@ -0,0 +1,117 @@
+#include <hl_communication/compression.h>
+#include <hl_communication/log_slice.h>
+#include <hl_communication/mapped_message_log.h>
+#include <hl_communication/message_log.h>
+#include <hl_communication/utils.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+#include <unistd.h>
+
+namespace hl_communication
+{
+LogSliceSettings::LogSliceSettings()
+  : start(0), end(std::numeric_limits<uint64_t>::max()), keep_gc(true), use_index(true), compressed(false)
+{
+}
+
+LogSliceStatistics::LogSliceStatistics() : messages_read(0), messages_written(0), used_index(false)
+{
+}
+
+/**
+ * Return true if messages from the given source should be kept
+ */
+static bool isSourceSelected(bool is_gc, uint32_t team_id, uint32_t robot_id, const LogSliceSettings& settings)
+{
+  if (is_gc)
+    return settings.keep_gc;
+  if (!settings.team_ids.empty() &&
+      std::find(settings.team_ids.begin(), settings.team_ids.end(), team_id) == settings.team_ids.end())
+    return false;
+  if (settings.robots.empty())
+    return true;
+  for (const RobotIdentifier& robot : settings.robots)
+  {
+    if (robot.team_id() == team_id && robot.robot_id() == robot_id)
+      return true;
+  }
+  return false;
+}
+
+static void sliceWithIndex(const std::string& input_path, const std::string& output_path,
+                           const LogSliceSettings& settings, LogSliceStatistics* statistics)
+{
+  MappedMessageLog log(input_path);
+  std::vector<MappedMessageLog::IndexEntry> entries =
+      log.getEntries(settings.start, settings.end, [&settings](const MappedMessageLog::IndexSource& source) {
+        return isSourceSelected(source.is_gc, source.team_id, source.robot_id, settings);
+      });
+  OfflineLogWriter output(output_path, log.getOffset(), settings.compressed);
+  for (const MappedMessageLog::IndexEntry& entry : entries)
+  {
+    output.writeSerialized(log.getSerializedMessage(entry), entry.size);
+  }
+  output.flush();
+  statistics->messages_read = entries.size();
+  statistics->messages_written = entries.size();
+  statistics->used_index = true;
+}
+
+static void sliceSequentially(const std::string& input_path, const std::string& output_path,
+                              const LogSliceSettings& settings, LogSliceStatistics* statistics)
+{
+  MessageLogReader reader(input_path);
+  std::unique_ptr<OfflineLogWriter> output;
+  const char* data;
+  size_t size;
+  GameMsgSummary summary;
+  while (reader.readSerialized(&data, &size))
+  {
+    // Header fields preceding the first message are known here, the others are written at the end
+    if (!output)
+    {
+      output.reset(new OfflineLogWriter(output_path, reader.getHeader().time_offset(), settings.compressed));
+    }
+    statistics->messages_read++;
+    if (!summarizeGameMsg(data, size, &summary))
+    {
+      throw std::runtime_error(HL_DEBUG + "failed to parse a GameMsg in '" + input_path + "'");
+    }
+    bool in_interval = summary.utc_time_stamp >= settings.start && summary.utc_time_stamp <= settings.end;
+    if (!summary.has_utc_time_stamp || !in_interval)
+      continue;
+    if (!(summary.has_gc_msg || (summary.has_robot_msg && summary.has_robot_id)) ||
+        !isSourceSelected(summary.has_gc_msg, summary.team_id, summary.robot_id, settings))
+      continue;
+    output->writeSerialized(data, size);
+    statistics->messages_written++;
+  }
+  if (!output)
+  {
+    output.reset(new OfflineLogWriter(output_path, reader.getHeader().time_offset(), settings.compressed));
+  }
+  // The last time_offset of a log prevails
+  output->setTimeOffset(reader.getHeader().time_offset());
+  output->flush();
+}
+
+LogSliceStatistics sliceLog(const std::string& input_path, const std::string& output_path,
+                            const LogSliceSettings& settings)
+{
+  LogSliceStatistics statistics;
+  bool has_index = access(MappedMessageLog::getIndexPath(input_path).c_str(), F_OK) == 0;
+  if (settings.use_index && has_index && !isCompressedFile(input_path))
+  {
+    sliceWithIndex(input_path, output_path, settings, &statistics);
+  }
+  else
+  {
+    sliceSequentially(input_path, output_path, settings, &statistics);
+  }
+  return statistics;
+}
+
+}  // namespace hl_communication
@@ -0,0 +1,466 @@
+#include <hl_communication/compression.h>
+#include <hl_communication/mapped_message_log.h>
+#include <hl_communication/message_log.h>
+#include <hl_communication/utils.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <tuple>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace hl_communication
+{
+/**
+ * Header of an index file, it is followed by the sources and then by the entries. Integers are stored with the native
+ * byte order since the index can always be rebuilt from the log.
+ */
+class IndexFileHeader
+{
+public:
+  char magic[8];
+  /**
+   * Size and modification time (in nanoseconds) of the log when it was indexed
+   */
+  uint64_t log_size;
+  int64_t log_mtime;
+  int64_t time_offset;
+  uint64_t main_gc_source;
+  uint64_t nb_sources;
+  uint64_t nb_entries;
+};
+
+static const char index_magic[8] = { 'H', 'L', 'I', 'D', 'X', '0', '0', '1' };
+
+/**
+ * Sources are ordered as RobotIdentifier for robots, GameController sources are stored after robots
+ */
+typedef std::tuple<uint32_t, uint32_t, uint32_t, uint64_t, uint32_t> SourceKey;
+
+MappedMessageLog::MappedMessageLog(const std::string& path_)
+  : path(path_)
+  , log_data(nullptr)
+  , log_size(0)
+  , index_data(nullptr)
+  , index_size(0)
+  , sources(nullptr)
+  , nb_sources(0)
+  , entries(nullptr)
+  , nb_entries(0)
+  , main_gc_source(0)
+  , time_offset(0)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1)
+  {
+    throw std::runtime_error(HL_DEBUG + "failed to open file '" + path + "': " + strerror(errno));
+  }
+  struct stat log_stat;
+  if (fstat(fd, &log_stat) == -1)
+  {
+    close(fd);
+    throw std::runtime_error(HL_DEBUG + "failed to stat file '" + path + "': " + strerror(errno));
+  }
+  log_size = log_stat.st_size;
+  int64_t log_mtime = (int64_t)log_stat.st_mtim.tv_sec * 1000000000 + log_stat.st_mtim.tv_nsec;
+  if (log_size > 0)
+  {
+    void* data = mmap(nullptr, log_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+      close(fd);
+      throw std::runtime_error(HL_DEBUG + "failed to map file '" + path + "': " + strerror(errno));
+    }
+    // Messages are read in an order which does not follow the log
+    madvise(data, log_size, MADV_RANDOM);
+    log_data = (const char*)data;
+  }
+  close(fd);
+  if (isCompressed(log_data, log_size))
+  {
+    unmap();
+    throw std::runtime_error(HL_DEBUG + "compressed logs cannot be mapped: '" + path + "'");
+  }
+  std::string index_path = getIndexPath(path);
+  try
+  {
+    if (!loadIndex(index_path, log_mtime))
+    {
+      buildIndex(index_path, log_mtime);
+    }
+  }
+  catch (...)
+  {
+    unmap();
+    throw;
+  }
+}
+
+MappedMessageLog::~MappedMessageLog()
+{
+  unmap();
+}
+
+std::string MappedMessageLog::getIndexPath(const std::string& log_path)
+{
+  return log_path + ".idx";
+}
+
+uint64_t MappedMessageLog::getStart() const
+{
+  uint64_t min_ts = std::numeric_limits<uint64_t>::max();
+  for (size_t idx = 0; idx < nb_sources; idx++)
+  {
+    const IndexSource& source = sources[idx];
+    if (source.is_gc && idx != main_gc_source)
+      continue;
+    min_ts = std::min(min_ts, entries[source.begin].utc_time_stamp);
+  }
+  return min_ts;
+}
+
+uint64_t MappedMessageLog::getEnd() const
+{
+  uint64_t max_ts = 0;
+  for (size_t idx = 0; idx < nb_sources; idx++)
+  {
+    const IndexSource& source = sources[idx];
+    if (source.is_gc && idx != main_gc_source)
+      continue;
+    max_ts = std::max(max_ts, entries[source.end - 1].utc_time_stamp);
+  }
+  return max_ts;
+}
+
+int64_t MappedMessageLog::getOffset() const
+{
+  return time_offset;
+}
+
+size_t MappedMessageLog::getNbMessages() const
+{
+  return nb_entries;
+}
+
+std::vector<RobotIdentifier> MappedMessageLog::getRobots() const
+{
+  std::vector<RobotIdentifier> robots;
+  for (size_t idx = 0; idx < nb_sources; idx++)
+  {
+    if (sources[idx].is_gc)
+      continue;
+    RobotIdentifier robot_id;
+    robot_id.set_team_id(sources[idx].team_id);
+    robot_id.set_robot_id(sources[idx].robot_id);
+    robots.push_back(robot_id);
+  }
+  return robots;
+}
+
+MessageManager::Status MappedMessageLog::getStatus(uint64_t time_stamp, bool system_clock) const
+{
+  return getStatus(time_stamp, 0, false, system_clock);
+}
+
+MessageManager::Status MappedMessageLog::getStatus(uint64_t time_stamp, uint64_t history_length,
+                                                   bool system_clock) const
+{
+  if (system_clock)
+  {
+    time_stamp -= time_offset;
+  }
+  return getStatus(time_stamp, time_stamp - history_length, true, false);
+}
+
+MessageManager::Status MappedMessageLog::getStatus(uint64_t time_stamp, uint64_t min_ts, bool use_min_ts,
+                                                   bool system_clock) const
+{
+  if (system_clock)
+  {
+    time_stamp -= time_offset;
+  }
+  MessageManager::Status status;
+  GameMsg msg;
+  for (size_t idx = 0; idx < nb_sources; idx++)
+  {
+    const IndexSource& source = sources[idx];
+    if (source.is_gc && idx != main_gc_source)
+      continue;
+    const IndexEntry* entry = findLast(source, time_stamp);
+    if (entry == nullptr || (use_min_ts && entry->utc_time_stamp < min_ts))
+      continue;
+    readMessage(*entry, &msg);
+    if (source.is_gc)
+    {
+      status.gc_message = msg.gc_msg();
+    }
+    else
+    {
+      status.robot_messages[msg.robot_msg().robot_id()] = msg.robot_msg();
+    }
+  }
+  return status;
+}
+
+bool MappedMessageLog::loadIndex(const std::string& index_path, int64_t log_mtime)
+{
+  int fd = open(index_path.c_str(), O_RDONLY);
+  if (fd == -1)
+    return false;
+  struct stat index_stat;
+  if (fstat(fd, &index_stat) == -1 || (size_t)index_stat.st_size < sizeof(IndexFileHeader))
+  {
+    close(fd);
+    return false;
+  }
+  size_t size = index_stat.st_size;
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  const IndexFileHeader* header = (const IndexFileHeader*)data;
+  const IndexSource* file_sources = (const IndexSource*)((const char*)data + sizeof(IndexFileHeader));
+  bool valid = memcmp(header->magic, index_magic, sizeof(index_magic)) == 0 && header->log_size == log_size &&
+               header->log_mtime == log_mtime && header->nb_sources <= size && header->nb_entries <= size &&
+               sizeof(IndexFileHeader) + header->nb_sources * sizeof(IndexSource) +
+                       header->nb_entries * sizeof(IndexEntry) ==
+                   size &&
+               header->main_gc_source <= header->nb_sources;
+  // Sources are read entirely on each request, their consistency is checked once
+  for (size_t idx = 0; valid && idx < header->nb_sources; idx++)
+  {
+    const IndexSource& source = file_sources[idx];
+    valid = source.begin < source.end && source.end <= header->nb_entries;
+  }
+  if (!valid)
+  {
+    munmap(data, size);
+    return false;
+  }
+  index_data = data;
+  index_size = size;
+  sources = file_sources;
+  entries = (const IndexEntry*)(file_sources + header->nb_sources);
+  nb_sources = header->nb_sources;
+  nb_entries = header->nb_entries;
+  main_gc_source = header->main_gc_source;
+  time_offset = header->time_offset;
+  return true;
+}
+
+void MappedMessageLog::buildIndex(const std::string& index_path, int64_t log_mtime)
+{
+  std::vector<GameMsgSpan> spans;
+  GameMsgCollection header;
+  size_t scanned = scanGameMsgCollection(log_data, log_size, &spans, &header);
+  if (scanned != log_size)
+  {
+    if (!header.has_streaming_log_version())
+    {
+      throw std::runtime_error(HL_DEBUG + "invalid GameMsgCollection in '" + path + "'");
+    }
+    std::cerr << HL_DEBUG << "ignoring " << (log_size - scanned) << " truncated bytes at the end of '" << path << "'"
+              << std::endl;
+  }
+  time_offset = header.time_offset();
+  std::map<SourceKey, std::vector<IndexEntry>> entries_by_source;
+  bool has_main_gc_source = false;
+  SourceKey main_gc_key;
+  GameMsgSummary summary;
+  for (const GameMsgSpan& span : spans)
+  {
+    if (!summarizeGameMsg(log_data + span.offset, span.size, &summary))
+    {
+      throw std::runtime_error(HL_DEBUG + "failed to parse a GameMsg in '" + path + "'");
+    }
+    SourceKey key;
+    if (summary.has_robot_msg)
+    {
+      if (!summary.has_robot_id)
+      {
+        throw std::runtime_error(HL_DEBUG + "MappedMessageLog can only handle identified RobotMsg");
+      }
+      if (!summary.has_utc_time_stamp)
+      {
+        throw std::runtime_error(HL_DEBUG + "MappedMessageLog can only handle utc time_stamped RobotMsg");
+      }
+      key = SourceKey(0, summary.team_id, summary.robot_id, 0, 0);
+    }
+    else if (summary.has_gc_msg)
+    {
+      if (!summary.has_utc_time_stamp)
+      {
+        throw std::runtime_error(HL_DEBUG + "MappedMessageLog can only handle utc time_stamped GCMsg");
+      }
+      key = SourceKey(1, 0, 0, summary.src_ip, summary.src_port);
+      if (!has_main_gc_source)
+      {
+        has_main_gc_source = true;
+        main_gc_key = key;
+      }
+    }
+    else
+    {
+      continue;
+    }
+    entries_by_source[key].push_back({ summary.utc_time_stamp, span.offset, span.size });
+  }
+  built_sources.clear();
+  built_entries.clear();
+  built_entries.reserve(spans.size());
+  main_gc_source = entries_by_source.size();
+  for (auto& source_entry : entries_by_source)
+  {
+    const SourceKey& key = source_entry.first;
+    std::vector<IndexEntry>& source_entries = source_entry.second;
+    // Entries are already ordered by position in the log
+    std::stable_sort(source_entries.begin(), source_entries.end(), [](const IndexEntry& a, const IndexEntry& b) {
+      return a.utc_time_stamp < b.utc_time_stamp;
+    });
+    if (has_main_gc_source && key == main_gc_key)
+    {
+      main_gc_source = built_sources.size();
+    }
+    IndexSource source;
+    source.is_gc = std::get<0>(key);
+    source.team_id = std::get<1>(key);
+    source.robot_id = std::get<2>(key);
+    source.src_ip = std::get<3>(key);
+    source.src_port = std::get<4>(key);
+    source.begin = built_entries.size();
+    source.end = source.begin + source_entries.size();
+    built_sources.push_back(source);
+    built_entries.insert(built_entries.end(), source_entries.begin(), source_entries.end());
+  }
+  sources = built_sources.data();
+  nb_sources = built_sources.size();
+  entries = built_entries.data();
+  nb_entries = built_entries.size();
+  // Once saved, the index is mapped in order to keep in memory only the parts which are used
+  if (saveIndex(index_path, log_mtime) && loadIndex(index_path, log_mtime))
+  {
+    std::vector<IndexSource>().swap(built_sources);
+    std::vector<IndexEntry>().swap(built_entries);
+    return;
+  }
+  std::cerr << HL_DEBUG << "failed to save index of '" << path << "' to '" << index_path << "'" << std::endl;
+}
+
+bool MappedMessageLog::saveIndex(const std::string& index_path, int64_t log_mtime) const
+{
+  IndexFileHeader header;
+  memcpy(header.magic, index_magic, sizeof(index_magic));
+  header.log_size = log_size;
+  header.log_mtime = log_mtime;
+  header.time_offset = time_offset;
+  header.main_gc_source = main_gc_source;
+  header.nb_sources = nb_sources;
+  header.nb_entries = nb_entries;
+  // The index is written to a temporary file and then renamed, readers never see a partial index
+  std::string tmp_path = index_path + ".tmp";
+  int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1)
+    return false;
+  std::pair<const void*, size_t> chunks[3] = { { &header, sizeof(header) },
+                                               { sources, nb_sources * sizeof(IndexSource) },
+                                               { entries, nb_entries * sizeof(IndexEntry) } };
+  for (const auto& chunk : chunks)
+  {
+    size_t written = 0;
+    while (written < chunk.second)
+    {
+      ssize_t result = write(fd, (const char*)chunk.first + written, chunk.second - written);
+      if (result == -1 && errno == EINTR)
+        continue;
+      if (result == -1)
+      {
+        close(fd);
+        unlink(tmp_path.c_str());
+        return false;
+      }
+      written += result;
+    }
+  }
+  if (close(fd) == -1 || rename(tmp_path.c_str(), index_path.c_str()) == -1)
+  {
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void MappedMessageLog::unmap()
+{
+  if (log_data != nullptr)
+  {
+    munmap((void*)log_data, log_size);
+    log_data = nullptr;
+  }
+  if (index_data != nullptr)
+  {
+    munmap(index_data, index_size);
+    index_data = nullptr;
+  }
+}
+
+const MappedMessageLog::IndexEntry* MappedMessageLog::findLast(const IndexSource& source, uint64_t time_stamp) const
+{
+  const IndexEntry* begin = entries + source.begin;
+  const IndexEntry* end = entries + source.end;
+  const IndexEntry* it = std::upper_bound(
+      begin, end, time_stamp, [](uint64_t ts, const IndexEntry& entry) { return ts < entry.utc_time_stamp; });
+  if (it == begin)
+    return nullptr;
+  return it - 1;
+}
+
+std::vector<MappedMessageLog::IndexEntry>
+MappedMessageLog::getEntries(uint64_t start, uint64_t end, const std::function<bool(const IndexSource&)>& filter) const
+{
+  std::vector<IndexEntry> result;
+  for (size_t idx = 0; idx < nb_sources; idx++)
+  {
+    const IndexSource& source = sources[idx];
+    if (!filter(source))
+      continue;
+    const IndexEntry* source_begin = entries + source.begin;
+    const IndexEntry* source_end = entries + source.end;
+    const IndexEntry* it = std::lower_bound(source_begin, source_end, start, [](const IndexEntry& entry, uint64_t ts) {
+      return entry.utc_time_stamp < ts;
+    });
+    for (; it != source_end && it->utc_time_stamp <= end; it++)
+    {
+      result.push_back(*it);
+    }
+  }
+  std::sort(result.begin(), result.end(),
+            [](const IndexEntry& a, const IndexEntry& b) { return a.offset < b.offset; });
+  return result;
+}
+
+const char* MappedMessageLog::getSerializedMessage(const IndexEntry& entry) const
+{
+  if (entry.offset > log_size || entry.size > log_size - entry.offset)
+  {
+    throw std::runtime_error(HL_DEBUG + "invalid message at offset " + std::to_string(entry.offset) + " in '" + path +
+                             "'");
+  }
+  return log_data + entry.offset;
+}
+
+void MappedMessageLog::readMessage(const IndexEntry& entry, GameMsg* msg) const
+{
+  if (!msg->ParseFromArray(getSerializedMessage(entry), entry.size))
+  {
+    throw std::runtime_error(HL_DEBUG + "failed to read message at offset " + std::to_string(entry.offset) + " in '" +
+                             path + "'");
+  }
+}
+
+}  // namespace hl_communication
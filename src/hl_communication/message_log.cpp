@@ -0,0 +1,1241 @@
+#include <hl_communication/compression.h>
+#include <hl_communication/message_log.h>
+#include <hl_communication/utils.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace hl_communication
+{
+// Wire types used by protobuf
+static const int varint_type = 0;
+static const int fixed64_type = 1;
+static const int length_type = 2;
+static const int fixed32_type = 5;
+
+// Fields of GameMsgCollection
+static const int messages_field = 1;
+static const int time_offset_field = 2;
+static const int streaming_log_version_field = 3;
+
+// Fields used to summarize a GameMsg
+static const int game_msg_robot_msg_field = 1;
+static const int game_msg_gc_msg_field = 2;
+static const int game_msg_identifier_field = 3;
+static const int robot_msg_perception_field = 3;
+static const int robot_msg_team_play_field = 5;
+static const int robot_msg_robot_id_field = 6;
+static const int robot_msg_time_stamp_field = 7;
+static const int robot_msg_utc_time_stamp_field = 10;
+static const int gc_msg_utc_time_stamp_field = 15;
+static const int team_id_field = 1;
+static const int robot_id_field = 2;
+static const int src_ip_field = 2;
+static const int src_port_field = 3;
+static const int perception_ball_field = 1;
+static const int perception_ball_velocity_field = 6;
+
+static void appendVarint(uint64_t value, std::string* buffer)
+{
+  while (value >= 0x80)
+  {
+    buffer->push_back((char)(value | 0x80));
+    value >>= 7;
+  }
+  buffer->push_back((char)value);
+}
+
+static size_t getVarintSize(uint64_t value)
+{
+  size_t size = 1;
+  while (value >= 0x80)
+  {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+static void appendTimeOffset(int64_t time_offset, std::string* buffer)
+{
+  appendVarint(time_offset_field << 3 | varint_type, buffer);
+  appendVarint((uint64_t)time_offset, buffer);
+}
+
+/**
+ * Write the whole content of 'data' to 'fd', return false on failure
+ */
+static bool writeAll(int fd, const std::string& data)
+{
+  size_t written = 0;
+  while (written < data.size())
+  {
+    ssize_t result = ::write(fd, data.data() + written, data.size() - written);
+    if (result == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    written += result;
+  }
+  return true;
+}
+
+/**
+ * Read a varint at data[*pos], return false if the varint is truncated or too long
+ */
+static bool readVarint(const char* data, size_t size, size_t* pos, uint64_t* value)
+{
+  *value = 0;
+  for (int shift = 0; shift < 64 && *pos < size; shift += 7)
+  {
+    uint8_t byte = data[*pos];
+    (*pos)++;
+    *value |= (uint64_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+/**
+ * Read the field starting at data[*pos] and move *pos after it. For varints, 'value' is the decoded value, for
+ * length-delimited fields it is the size of the payload which starts at data[*pos - value].
+ * Returns false if the field is truncated or malformed, groups are not supported since hl_communication does not use
+ * them.
+ */
+static bool readField(const char* data, size_t size, size_t* pos, int* field, int* wire_type, uint64_t* value)
+{
+  uint64_t tag;
+  if (!readVarint(data, size, pos, &tag))
+    return false;
+  *field = tag >> 3;
+  *wire_type = tag & 0x7;
+  if (*wire_type == varint_type)
+  {
+    return readVarint(data, size, pos, value);
+  }
+  if (*wire_type == length_type)
+  {
+    if (!readVarint(data, size, pos, value) || *value > size - *pos)
+      return false;
+    *pos += *value;
+    return true;
+  }
+  if (*wire_type == fixed64_type || *wire_type == fixed32_type)
+  {
+    size_t length = *wire_type == fixed64_type ? 8 : 4;
+    if (length > size - *pos)
+      return false;
+    *pos += length;
+    *value = 0;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Check the field starting at data[pos] that readField could not read. Returns if it is only truncated, throws
+ * runtime_error if it is malformed or if its payload is larger than 'max_size' bytes.
+ */
+static void checkIncompleteField(const char* data, size_t size, size_t pos, size_t max_size, const std::string& path)
+{
+  size_t start = pos;
+  uint64_t tag, length;
+  if (!readVarint(data, size, &pos, &tag))
+  {
+    // Varints are at most 10 bytes long
+    if (pos - start >= 10)
+      throw std::runtime_error(HL_DEBUG + "invalid varint in '" + path + "'");
+    return;
+  }
+  int wire_type = tag & 0x7;
+  if (wire_type != varint_type && wire_type != length_type && wire_type != fixed64_type && wire_type != fixed32_type)
+  {
+    throw std::runtime_error(HL_DEBUG + "invalid wire type " + std::to_string(wire_type) + " in '" + path + "'");
+  }
+  if (wire_type != length_type)
+    return;
+  size_t length_start = pos;
+  if (!readVarint(data, size, &pos, &length))
+  {
+    if (pos - length_start >= 10)
+      throw std::runtime_error(HL_DEBUG + "invalid length in '" + path + "'");
+    return;
+  }
+  if (length > max_size)
+  {
+    throw std::runtime_error(HL_DEBUG + "field of " + std::to_string(length) + " bytes in '" + path +
+                             "' exceeds the maximal record size (" + std::to_string(max_size) + " bytes)");
+  }
+}
+
+size_t scanGameMsgCollection(const char* data, size_t size, std::vector<GameMsgSpan>* spans,
+                             GameMsgCollection* header)
+{
+  // Fields which are not messages are gathered and parsed at once
+  std::string header_data;
+  size_t scanned = 0;
+  while (scanned < size)
+  {
+    size_t pos = scanned;
+    int field, wire_type;
+    uint64_t value;
+    if (!readField(data, size, &pos, &field, &wire_type, &value))
+      break;
+    if (field == messages_field && wire_type == length_type)
+    {
+      spans->push_back({ pos - value, (size_t)value });
+    }
+    else
+    {
+      header_data.append(data + scanned, pos - scanned);
+    }
+    scanned = pos;
+  }
+  if (!header->ParseFromString(header_data))
+  {
+    throw std::runtime_error(HL_DEBUG + "invalid header for GameMsgCollection");
+  }
+  return scanned;
+}
+
+/**
+ * Fill the fields of 'summary' found in a serialized RobotMsg
+ */
+static bool summarizeRobotMsg(const char* data, size_t size, GameMsgSummary* summary)
+{
+  size_t pos = 0;
+  while (pos < size)
+  {
+    int field, wire_type;
+    uint64_t value;
+    if (!readField(data, size, &pos, &field, &wire_type, &value))
+      return false;
+    if (field == robot_msg_utc_time_stamp_field && wire_type == varint_type)
+    {
+      summary->has_utc_time_stamp = true;
+      summary->utc_time_stamp = value;
+    }
+    else if (field == robot_msg_robot_id_field && wire_type == length_type)
+    {
+      summary->has_robot_id = true;
+      const char* robot_id_data = data + pos - value;
+      size_t robot_id_pos = 0;
+      while (robot_id_pos < value)
+      {
+        int id_field, id_wire_type;
+        uint64_t id_value;
+        if (!readField(robot_id_data, value, &robot_id_pos, &id_field, &id_wire_type, &id_value))
+          return false;
+        if (id_field == team_id_field && id_wire_type == varint_type)
+        {
+          summary->team_id = id_value;
+        }
+        else if (id_field == robot_id_field && id_wire_type == varint_type)
+        {
+          summary->robot_id = id_value;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * Fill the fields of 'summary' found in a serialized GCMsg
+ */
+static bool summarizeGCMsg(const char* data, size_t size, GameMsgSummary* summary)
+{
+  size_t pos = 0;
+  while (pos < size)
+  {
+    int field, wire_type;
+    uint64_t value;
+    if (!readField(data, size, &pos, &field, &wire_type, &value))
+      return false;
+    if (field == gc_msg_utc_time_stamp_field && wire_type == varint_type)
+    {
+      summary->has_utc_time_stamp = true;
+      summary->utc_time_stamp = value;
+    }
+  }
+  return true;
+}
+
+/**
+ * Fill the fields of 'summary' found in a serialized MsgIdentifier
+ */
+static bool summarizeIdentifier(const char* data, size_t size, GameMsgSummary* summary)
+{
+  size_t pos = 0;
+  while (pos < size)
+  {
+    int field, wire_type;
+    uint64_t value;
+    if (!readField(data, size, &pos, &field, &wire_type, &value))
+      return false;
+    if (field == src_ip_field && wire_type == varint_type)
+    {
+      summary->src_ip = value;
+    }
+    else if (field == src_port_field && wire_type == varint_type)
+    {
+      summary->src_port = value;
+    }
+  }
+  return true;
+}
+
+bool summarizeGameMsg(const char* data, size_t size, GameMsgSummary* summary)
+{
+  *summary = GameMsgSummary();
+  size_t pos = 0;
+  while (pos < size)
+  {
+    int field, wire_type;
+    uint64_t value;
+    if (!readField(data, size, &pos, &field, &wire_type, &value))
+      return false;
+    if (wire_type != length_type)
+      continue;
+    const char* payload = data + pos - value;
+    bool valid = true;
+    // robot_msg and gc_msg belong to a oneof: the last one prevails
+    if (field == game_msg_robot_msg_field)
+    {
+      summary->has_robot_msg = true;
+      summary->has_gc_msg = false;
+      valid = summarizeRobotMsg(payload, value, summary);
+    }
+    else if (field == game_msg_gc_msg_field)
+    {
+      summary->has_robot_msg = false;
+      summary->has_gc_msg = true;
+      valid = summarizeGCMsg(payload, value, summary);
+    }
+    else if (field == game_msg_identifier_field)
+    {
+      valid = summarizeIdentifier(payload, value, summary);
+    }
+    if (!valid)
+      return false;
+  }
+  return true;
+}
+
+/**
+ * Call 'parse' for each span, work is split in chunks among 'nb_threads' threads.
+ * Throws runtime_error if one of the calls returned false
+ */
+static void parseSpans(const char* data, const std::vector<GameMsgSpan>& spans, int nb_threads,
+                       const std::function<bool(size_t, const char*, size_t)>& parse)
+{
+  if (nb_threads <= 0)
+  {
+    nb_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  size_t chunk_size = (spans.size() + nb_threads - 1) / nb_threads;
+  std::vector<char> chunk_failed(nb_threads, false);
+  std::vector<std::thread> threads;
+  for (int thread_idx = 0; thread_idx < nb_threads; thread_idx++)
+  {
+    size_t start = std::min(spans.size(), thread_idx * chunk_size);
+    size_t end = std::min(spans.size(), start + chunk_size);
+    threads.emplace_back([&, thread_idx, start, end]() {
+      for (size_t idx = start; idx < end; idx++)
+      {
+        if (!parse(idx, data + spans[idx].offset, spans[idx].size))
+        {
+          chunk_failed[thread_idx] = true;
+          return;
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+  if (std::find(chunk_failed.begin(), chunk_failed.end(), true) != chunk_failed.end())
+  {
+    throw std::runtime_error(HL_DEBUG + "failed to parse a GameMsg");
+  }
+}
+
+void parseGameMsgs(const char* data, const std::vector<GameMsgSpan>& spans, std::vector<GameMsg>* messages,
+                   int nb_threads)
+{
+  messages->clear();
+  messages->resize(spans.size());
+  parseSpans(data, spans, nb_threads, [messages](size_t idx, const char* msg_data, size_t msg_size) {
+    return (*messages)[idx].ParseFromArray(msg_data, msg_size);
+  });
+}
+
+/**
+ * Append to 'out' the fields of a serialized message whose number is in 'kept_fields'
+ */
+static bool appendSelectedFields(const char* data, size_t size, const std::vector<int>& kept_fields, std::string* out)
+{
+  size_t pos = 0;
+  while (pos < size)
+  {
+    size_t start = pos;
+    int field, wire_type;
+    uint64_t value;
+    if (!readField(data, size, &pos, &field, &wire_type, &value))
+      return false;
+    if (std::find(kept_fields.begin(), kept_fields.end(), field) != kept_fields.end())
+    {
+      out->append(data + start, pos - start);
+    }
+  }
+  return true;
+}
+
+/**
+ * Append to 'out' the fields of a serialized RobotMsg which are part of its digest
+ */
+static bool appendRobotMsgDigest(const char* data, size_t size, std::string* out)
+{
+  static const std::vector<int> kept_fields = { robot_msg_team_play_field, robot_msg_robot_id_field,
+                                                robot_msg_time_stamp_field, robot_msg_utc_time_stamp_field };
+  static const std::vector<int> kept_perception_fields = { perception_ball_field, perception_ball_velocity_field };
+  size_t pos = 0;
+  while (pos < size)
+  {
+    size_t start = pos;
+    int field, wire_type;
+    uint64_t value;
+    if (!readField(data, size, &pos, &field, &wire_type, &value))
+      return false;
+    if (field == robot_msg_perception_field && wire_type == length_type)
+    {
+      std::string perception;
+      if (!appendSelectedFields(data + pos - value, value, kept_perception_fields, &perception))
+        return false;
+      appendVarint(robot_msg_perception_field << 3 | length_type, out);
+      appendVarint(perception.size(), out);
+      out->append(perception);
+    }
+    else if (std::find(kept_fields.begin(), kept_fields.end(), field) != kept_fields.end())
+    {
+      out->append(data + start, pos - start);
+    }
+  }
+  return true;
+}
+
+bool parseGameMsgDigest(const char* data, size_t size, GameMsg* digest)
+{
+  std::string filtered;
+  size_t pos = 0;
+  while (pos < size)
+  {
+    size_t start = pos;
+    int field, wire_type;
+    uint64_t value;
+    if (!readField(data, size, &pos, &field, &wire_type, &value))
+      return false;
+    if (field == game_msg_robot_msg_field && wire_type == length_type)
+    {
+      std::string robot_msg;
+      if (!appendRobotMsgDigest(data + pos - value, value, &robot_msg))
+        return false;
+      appendVarint(game_msg_robot_msg_field << 3 | length_type, &filtered);
+      appendVarint(robot_msg.size(), &filtered);
+      filtered.append(robot_msg);
+    }
+    else
+    {
+      filtered.append(data + start, pos - start);
+    }
+  }
+  return digest->ParseFromString(filtered);
+}
+
+void parseGameMsgDigests(const char* data, const std::vector<GameMsgSpan>& spans, std::vector<GameMsg>* digests,
+                         std::vector<std::string>* serialized, int nb_threads)
+{
+  digests->clear();
+  digests->resize(spans.size());
+  serialized->clear();
+  serialized->resize(spans.size());
+  parseSpans(data, spans, nb_threads, [&](size_t idx, const char* msg_data, size_t msg_size) {
+    if (!parseGameMsgDigest(msg_data, msg_size, &(*digests)[idx]))
+      return false;
+    if ((*digests)[idx].has_robot_msg())
+    {
+      (*serialized)[idx].assign(msg_data, msg_size);
+    }
+    return true;
+  });
+}
+
+/**
+ * Read the content of a log (decompressing it if required) and locate its messages
+ */
+static void readLog(const std::string& path, std::string* data, std::vector<GameMsgSpan>* spans,
+                    GameMsgCollection* header, int nb_threads)
+{
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  if (!in.good())
+  {
+    throw std::runtime_error(HL_DEBUG + "failed to open file '" + path + "'");
+  }
+  data->assign(in.tellg(), '\0');
+  in.seekg(0);
+  if (!in.read(&(*data)[0], data->size()))
+  {
+    throw std::runtime_error(HL_DEBUG + "failed to read file '" + path + "'");
+  }
+  if (isCompressed(data->data(), data->size()))
+  {
+    std::string compressed;
+    compressed.swap(*data);
+    size_t decoded = decompress(compressed.data(), compressed.size(), data, nb_threads);
+    if (decoded != compressed.size())
+    {
+      std::cerr << HL_DEBUG << "ignoring " << (compressed.size() - decoded)
+                << " truncated compressed bytes at the end of '" << path << "'" << std::endl;
+    }
+  }
+  size_t scanned = scanGameMsgCollection(data->data(), data->size(), spans, header);
+  if (scanned != data->size())
+  {
+    if (!header->has_streaming_log_version())
+    {
+      throw std::runtime_error(HL_DEBUG + "invalid GameMsgCollection in '" + path + "'");
+    }
+    std::cerr << HL_DEBUG << "ignoring " << (data->size() - scanned) << " truncated bytes at the end of '" << path
+              << "'" << std::endl;
+  }
+}
+
+void readGameMsgs(const std::string& path, std::vector<GameMsg>* messages, GameMsgCollection* header, int nb_threads)
+{
+  std::string data;
+  std::vector<GameMsgSpan> spans;
+  readLog(path, &data, &spans, header, nb_threads);
+  parseGameMsgs(data.data(), spans, messages, nb_threads);
+}
+
+void readGameMsgDigests(const std::string& path, std::vector<GameMsg>* digests, std::vector<std::string>* serialized,
+                        GameMsgCollection* header, int nb_threads)
+{
+  std::string data;
+  std::vector<GameMsgSpan> spans;
+  readLog(path, &data, &spans, header, nb_threads);
+  parseGameMsgDigests(data.data(), spans, digests, serialized, nb_threads);
+}
+
+MessageLogReader::MessageLogReader(const std::string& path_, size_t chunk_size_, size_t max_record_size_)
+  : path(path_)
+  , in(path_, std::ios::binary)
+  , chunk_size(chunk_size_)
+  , max_record_size(max_record_size_)
+  , buffer_pos(0)
+  , truncated_bytes(0)
+{
+  if (!in.good())
+  {
+    throw std::runtime_error(HL_DEBUG + "failed to open file '" + path + "'");
+  }
+  char magic[COMPRESSION_HEADER_SIZE];
+  in.read(magic, COMPRESSION_HEADER_SIZE);
+  compressed = isCompressed(magic, in.gcount());
+  if (!compressed)
+  {
+    buffer.assign(magic, in.gcount());
+  }
+}
+
+bool MessageLogReader::read(GameMsg* msg)
+{
+  const char* data;
+  size_t size;
+  if (!readSerialized(&data, &size))
+    return false;
+  if (msg != nullptr && !msg->ParseFromArray(data, size))
+  {
+    throw std::runtime_error(HL_DEBUG + "failed to parse a GameMsg in '" + path + "'");
+  }
+  return true;
+}
+
+bool MessageLogReader::readSerialized(const char** data, size_t* size)
+{
+  while (true)
+  {
+    size_t pos = buffer_pos;
+    int field, wire_type;
+    uint64_t value;
+    if (pos < buffer.size() && readField(buffer.data(), buffer.size(), &pos, &field, &wire_type, &value))
+    {
+      const char* field_data = buffer.data() + buffer_pos;
+      size_t field_size = pos - buffer_pos;
+      buffer_pos = pos;
+      if (field == messages_field && wire_type == length_type)
+      {
+        *data = buffer.data() + pos - value;
+        *size = value;
+        return true;
+      }
+      GameMsgCollection fields;
+      if (!fields.ParseFromArray(field_data, field_size))
+      {
+        throw std::runtime_error(HL_DEBUG + "invalid header for GameMsgCollection in '" + path + "'");
+      }
+      header.MergeFrom(fields);
+      continue;
+    }
+    // A malformed length would otherwise make the buffer grow until the end of the file
+    checkIncompleteField(buffer.data(), buffer.size(), buffer_pos, max_record_size, path);
+    if (fill())
+      continue;
+    size_t remaining = buffer.size() - buffer_pos + truncated_bytes;
+    if (remaining > 0)
+    {
+      if (!header.has_streaming_log_version())
+      {
+        throw std::runtime_error(HL_DEBUG + "invalid GameMsgCollection in '" + path + "'");
+      }
+      std::cerr << HL_DEBUG << "ignoring " << remaining << " truncated bytes at the end of '" << path << "'"
+                << std::endl;
+      buffer.clear();
+      buffer_pos = 0;
+      truncated_bytes = 0;
+    }
+    return false;
+  }
+}
+
+const GameMsgCollection& MessageLogReader::getHeader() const
+{
+  return header;
+}
+
+const std::string& MessageLogReader::getPath() const
+{
+  return path;
+}
+
+bool MessageLogReader::fill()
+{
+  // Consumed data is discarded so that the buffer only holds the field being read
+  buffer.erase(0, buffer_pos);
+  buffer_pos = 0;
+  if (compressed)
+    return fillCompressed();
+  size_t offset = buffer.size();
+  buffer.resize(offset + chunk_size);
+  in.read(&buffer[offset], chunk_size);
+  buffer.resize(offset + in.gcount());
+  return in.gcount() > 0;
+}
+
+bool MessageLogReader::fillCompressed()
+{
+  char block_header[COMPRESSED_BLOCK_HEADER_SIZE];
+  in.read(block_header, COMPRESSED_BLOCK_HEADER_SIZE);
+  if ((size_t)in.gcount() < COMPRESSED_BLOCK_HEADER_SIZE)
+  {
+    truncated_bytes += in.gcount();
+    return false;
+  }
+  size_t compressed_size, uncompressed_size;
+  try
+  {
+    // Sizes are checked before allocating the block
+    readCompressedBlockHeader(block_header, &compressed_size, &uncompressed_size);
+  }
+  catch (const std::runtime_error& exc)
+  {
+    throw std::runtime_error(HL_DEBUG + "malformed log '" + path + "': " + exc.what());
+  }
+  std::string block(compressed_size, '\0');
+  in.read(&block[0], compressed_size);
+  if ((size_t)in.gcount() < compressed_size)
+  {
+    truncated_bytes += COMPRESSED_BLOCK_HEADER_SIZE + in.gcount();
+    return false;
+  }
+  appendDecompressedBlock(block.data(), block.size(), uncompressed_size, &buffer);
+  return true;
+}
+
+void appendLogHeader(int64_t time_offset, std::string* buffer)
+{
+  appendVarint(streaming_log_version_field << 3 | varint_type, buffer);
+  appendVarint(STREAMING_LOG_VERSION, buffer);
+  appendTimeOffset(time_offset, buffer);
+}
+
+void appendLogRecord(const GameMsg& msg, std::string* buffer)
+{
+  appendVarint(messages_field << 3 | length_type, buffer);
+  appendVarint(msg.ByteSizeLong(), buffer);
+  if (!msg.AppendToString(buffer))
+  {
+    throw std::runtime_error(HL_DEBUG + "failed to serialize GameMsg");
+  }
+}
+
+void appendLogRecord(const char* data, size_t size, std::string* buffer)
+{
+  appendVarint(messages_field << 3 | length_type, buffer);
+  appendVarint(size, buffer);
+  buffer->append(data, size);
+}
+
+MessageLogWriter::MessageLogWriter(const std::string& path_, int64_t time_offset) : path(path_)
+{
+  fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (fd == -1)
+  {
+    throw std::runtime_error(HL_DEBUG + "failed to open file '" + path + "': " + strerror(errno));
+  }
+  appendLogHeader(time_offset, &buffer);
+  writeBuffer();
+}
+
+MessageLogWriter::~MessageLogWriter()
+{
+  close(fd);
+}
+
+void MessageLogWriter::write(const GameMsg& msg)
+{
+  appendLogRecord(msg, &buffer);
+  writeBuffer();
+}
+
+void MessageLogWriter::writeSerialized(const char* data, size_t size)
+{
+  appendLogRecord(data, size, &buffer);
+  writeBuffer();
+}
+
+void MessageLogWriter::setTimeOffset(int64_t time_offset)
+{
+  appendTimeOffset(time_offset, &buffer);
+  writeBuffer();
+}
+
+const std::string& MessageLogWriter::getPath() const
+{
+  return path;
+}
+
+void MessageLogWriter::writeBuffer()
+{
+  size_t written = 0;
+  while (written < buffer.size())
+  {
+    ssize_t result = ::write(fd, buffer.data() + written, buffer.size() - written);
+    if (result == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      buffer.clear();
+      throw std::runtime_error(HL_DEBUG + "failed to write in '" + path + "': " + strerror(errno));
+    }
+    written += result;
+  }
+  buffer.clear();
+}
+
+AsyncMessageLogWriter::Settings::Settings()
+  : buffer_size(1 << 20), nb_buffers(3), flush_period(100), sync_period(0)
+{
+}
+
+AsyncMessageLogWriter::Statistics::Statistics()
+  : messages_accepted(0)
+  , bytes_accepted(0)
+  , messages_dropped(0)
+  , bytes_dropped(0)
+  , blocked_writes(0)
+  , nb_flushes(0)
+  , bytes_flushed(0)
+  , nb_syncs(0)
+  , write_errors(0)
+  , max_pending_bytes(0)
+{
+}
+
+AsyncMessageLogWriter::AsyncMessageLogWriter(const std::string& path_, int64_t time_offset, const Settings& settings_)
+  : path(path_)
+  , settings(settings_)
+  , active(0)
+  , flush_requested(false)
+  , stop_requested(false)
+  , has_pending_offset(false)
+  , pending_offset(0)
+  , pending_bytes(0)
+{
+  if (settings.nb_buffers < 2)
+  {
+    throw std::logic_error(HL_DEBUG + "AsyncMessageLogWriter requires at least 2 buffers");
+  }
+  fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (fd == -1)
+  {
+    throw std::runtime_error(HL_DEBUG + "failed to open file '" + path + "': " + strerror(errno));
+  }
+  std::string header;
+  appendLogHeader(time_offset, &header);
+  if (!writeToFile(header))
+  {
+    std::string error = strerror(errno);
+    close(fd);
+    throw std::runtime_error(HL_DEBUG + "failed to write in '" + path + "': " + error);
+  }
+  buffers.resize(settings.nb_buffers);
+  for (int idx = 0; idx < settings.nb_buffers; idx++)
+  {
+    buffers[idx].reserve(settings.buffer_size);
+    if (idx != active)
+    {
+      free_buffers.push_back(idx);
+    }
+  }
+  thread = std::thread(&AsyncMessageLogWriter::run, this);
+}
+
+AsyncMessageLogWriter::~AsyncMessageLogWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop_requested = true;
+  }
+  condition.notify_all();
+  thread.join();
+  close(fd);
+}
+
+bool AsyncMessageLogWriter::write(const GameMsg& msg, bool wait_for_buffer)
+{
+  size_t msg_size = msg.ByteSizeLong();
+  size_t record_size = 1 + getVarintSize(msg_size) + msg_size;
+  std::unique_lock<std::mutex> lock(mutex);
+  appendPendingOffset();
+  if (!reserve(record_size, wait_for_buffer, lock))
+    return false;
+  // Serializing directly in the buffer avoids a copy, the background thread only holds the lock to swap buffers
+  appendLogRecord(msg, &buffers[active]);
+  accept(record_size);
+  statistics.messages_accepted++;
+  return true;
+}
+
+bool AsyncMessageLogWriter::writeSerialized(const char* data, size_t size, bool wait_for_buffer)
+{
+  size_t record_size = 1 + getVarintSize(size) + size;
+  std::unique_lock<std::mutex> lock(mutex);
+  appendPendingOffset();
+  if (!reserve(record_size, wait_for_buffer, lock))
+    return false;
+  appendLogRecord(data, size, &buffers[active]);
+  accept(record_size);
+  statistics.messages_accepted++;
+  return true;
+}
+
+void AsyncMessageLogWriter::setTimeOffset(int64_t time_offset)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  // Only the last offset matters, an offset which could not be appended yet is replaced
+  has_pending_offset = true;
+  pending_offset = time_offset;
+  appendPendingOffset();
+}
+
+void AsyncMessageLogWriter::flush()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  flush_requested = true;
+  condition.notify_all();
+  condition.wait(lock, [this]() { return pending_bytes == 0 && !has_pending_offset; });
+}
+
+AsyncMessageLogWriter::Statistics AsyncMessageLogWriter::getStatistics() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return statistics;
+}
+
+const std::string& AsyncMessageLogWriter::getPath() const
+{
+  return path;
+}
+
+bool AsyncMessageLogWriter::reserve(size_t size, bool wait_for_buffer, std::unique_lock<std::mutex>& lock)
+{
+  if (size > settings.buffer_size && !wait_for_buffer)
+  {
+    statistics.messages_dropped++;
+    statistics.bytes_dropped += size;
+    return false;
+  }
+  bool blocked = false;
+  // A record larger than a buffer is appended alone to an empty buffer, which grows until it has been written
+  while (!buffers[active].empty() && buffers[active].size() + size > settings.buffer_size)
+  {
+    if (!free_buffers.empty())
+    {
+      pending.push_back(active);
+      active = free_buffers.back();
+      free_buffers.pop_back();
+      condition.notify_all();
+    }
+    else if (wait_for_buffer)
+    {
+      blocked = true;
+      condition.wait(lock);
+    }
+    else
+    {
+      statistics.messages_dropped++;
+      statistics.bytes_dropped += size;
+      return false;
+    }
+  }
+  if (blocked)
+  {
+    statistics.blocked_writes++;
+  }
+  return true;
+}
+
+void AsyncMessageLogWriter::appendPendingOffset()
+{
+  if (!has_pending_offset)
+    return;
+  size_t record_size = 1 + getVarintSize((uint64_t)pending_offset);
+  if (!buffers[active].empty() && buffers[active].size() + record_size > settings.buffer_size)
+  {
+    if (free_buffers.empty())
+      return;
+    pending.push_back(active);
+    active = free_buffers.back();
+    free_buffers.pop_back();
+    condition.notify_all();
+  }
+  appendTimeOffset(pending_offset, &buffers[active]);
+  accept(record_size);
+  has_pending_offset = false;
+}
+
+void AsyncMessageLogWriter::accept(size_t size)
+{
+  pending_bytes += size;
+  statistics.bytes_accepted += size;
+  statistics.max_pending_bytes = std::max(statistics.max_pending_bytes, pending_bytes);
+}
+
+void AsyncMessageLogWriter::run()
+{
+  typedef std::chrono::steady_clock clock;
+  std::chrono::milliseconds flush_period(settings.flush_period);
+  std::chrono::milliseconds sync_period(settings.sync_period);
+  clock::time_point next_flush = clock::now() + flush_period;
+  clock::time_point next_sync = clock::now() + sync_period;
+  bool unsynced = false;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true)
+  {
+    clock::time_point now = clock::now();
+    if (pending.empty() && (flush_requested || stop_requested || now >= next_flush))
+    {
+      // The active buffer is handed over even if it is not full
+      if (!buffers[active].empty())
+      {
+        pending.push_back(active);
+        active = free_buffers.back();
+        free_buffers.pop_back();
+      }
+      flush_requested = false;
+      next_flush = now + flush_period;
+    }
+    if (!pending.empty())
+    {
+      int idx = pending.front();
+      pending.pop_front();
+      lock.unlock();
+      bool success = writeToFile(buffers[idx]);
+      int error = errno;
+      size_t written = buffers[idx].size();
+      if (buffers[idx].capacity() > settings.buffer_size)
+      {
+        // Memory taken by an oversize record is released
+        std::string().swap(buffers[idx]);
+        buffers[idx].reserve(settings.buffer_size);
+      }
+      lock.lock();
+      if (success)
+      {
+        statistics.nb_flushes++;
+        statistics.bytes_flushed += written;
+        unsynced = true;
+      }
+      else
+      {
+        statistics.write_errors++;
+        std::cerr << HL_DEBUG << "failed to write in '" << path << "': " << strerror(error) << std::endl;
+      }
+      pending_bytes -= written;
+      buffers[idx].clear();
+      free_buffers.push_back(idx);
+      appendPendingOffset();
+      condition.notify_all();
+    }
+    if (settings.sync_period > 0 && unsynced && (clock::now() >= next_sync || stop_requested))
+    {
+      lock.unlock();
+      fdatasync(fd);
+      lock.lock();
+      statistics.nb_syncs++;
+      unsynced = false;
+      next_sync = clock::now() + sync_period;
+    }
+    if (!pending.empty() || flush_requested)
+      continue;
+    if (stop_requested)
+    {
+      if (buffers[active].empty())
+        break;
+      continue;
+    }
+    clock::time_point wake_time = next_flush;
+    if (settings.sync_period > 0 && unsynced)
+    {
+      wake_time = std::min(wake_time, next_sync);
+    }
+    condition.wait_until(lock, wake_time, [this]() { return !pending.empty() || flush_requested || stop_requested; });
+  }
+}
+
+bool AsyncMessageLogWriter::writeToFile(const std::string& data)
+{
+  return writeAll(fd, data);
+}
+
+CompressedLogWriter::CompressedLogWriter(const std::string& path_, int64_t time_offset, size_t block_size_,
+                                         int max_pending_blocks_)
+  : path(path_), block_size(block_size_), max_pending_blocks(max_pending_blocks_), busy(false), stop_requested(false)
+{
+  if (max_pending_blocks < 1)
+  {
+    throw std::logic_error(HL_DEBUG + "CompressedLogWriter requires at least 1 pending block");
+  }
+  if (block_size > MAX_COMPRESSED_BLOCK_SIZE / 2)
+  {
+    throw std::logic_error(HL_DEBUG + "block_size is too large: " + std::to_string(block_size));
+  }
+  fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (fd == -1)
+  {
+    throw std::runtime_error(HL_DEBUG + "failed to open file '" + path + "': " + strerror(errno));
+  }
+  std::string header;
+  appendCompressionHeader(&header);
+  if (!writeAll(fd, header))
+  {
+    std::string write_error = strerror(errno);
+    close(fd);
+    throw std::runtime_error(HL_DEBUG + "failed to write in '" + path + "': " + write_error);
+  }
+  current_block.reserve(block_size);
+  appendLogHeader(time_offset, &current_block);
+  thread = std::thread(&CompressedLogWriter::run, this);
+}
+
+CompressedLogWriter::~CompressedLogWriter()
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    closeBlock(true, lock);
+    stop_requested = true;
+  }
+  condition.notify_all();
+  thread.join();
+  if (!error.empty())
+  {
+    std::cerr << error << std::endl;
+  }
+  close(fd);
+}
+
+void CompressedLogWriter::write(const GameMsg& msg)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  checkError();
+  appendLogRecord(msg, &current_block);
+  closeBlock(false, lock);
+}
+
+void CompressedLogWriter::writeSerialized(const char* data, size_t size)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  checkError();
+  appendLogRecord(data, size, &current_block);
+  closeBlock(false, lock);
+}
+
+void CompressedLogWriter::setTimeOffset(int64_t time_offset)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  checkError();
+  appendTimeOffset(time_offset, &current_block);
+  closeBlock(false, lock);
+}
+
+void CompressedLogWriter::flush()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  closeBlock(true, lock);
+  condition.wait(lock, [this]() { return pending.empty() && !busy; });
+  checkError();
+}
+
+const std::string& CompressedLogWriter::getPath() const
+{
+  return path;
+}
+
+void CompressedLogWriter::closeBlock(bool force, std::unique_lock<std::mutex>& lock)
+{
+  if (current_block.empty() || (!force && current_block.size() < block_size))
+    return;
+  condition.wait(lock, [this]() { return (int)pending.size() < max_pending_blocks; });
+  pending.push_back(std::move(current_block));
+  current_block.clear();
+  current_block.reserve(block_size);
+  condition.notify_all();
+}
+
+void CompressedLogWriter::checkError() const
+{
+  if (!error.empty())
+  {
+    throw std::runtime_error(error);
+  }
+}
+
+void CompressedLogWriter::run()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true)
+  {
+    condition.wait(lock, [this]() { return !pending.empty() || stop_requested; });
+    if (pending.empty())
+      break;
+    std::string block = std::move(pending.front());
+    pending.pop_front();
+    busy = true;
+    // Slots are released before compression, so that producers only wait when compression is slower than them
+    condition.notify_all();
+    lock.unlock();
+    std::string block_error;
+    try
+    {
+      std::string compressed;
+      appendCompressedBlock(block.data(), block.size(), &compressed);
+      if (!writeAll(fd, compressed))
+      {
+        block_error = HL_DEBUG + "failed to write in '" + path + "': " + strerror(errno);
+      }
+    }
+    catch (const std::exception& exc)
+    {
+      // Including blocks larger than MAX_COMPRESSED_BLOCK_SIZE
+      block_error = exc.what();
+    }
+    lock.lock();
+    busy = false;
+    if (error.empty())
+    {
+      error = block_error;
+    }
+    condition.notify_all();
+  }
+}
+
+OfflineLogWriter::OfflineLogWriter(const std::string& path_, int64_t time_offset, bool compressed) : path(path_)
+{
+  if (compressed)
+  {
+    compressed_writer.reset(new CompressedLogWriter(path, time_offset));
+  }
+  else
+  {
+    writer.reset(new AsyncMessageLogWriter(path, time_offset));
+  }
+}
+
+void OfflineLogWriter::write(const GameMsg& msg)
+{
+  if (compressed_writer)
+  {
+    compressed_writer->write(msg);
+  }
+  else if (!writer->write(msg, true))
+  {
+    throw std::runtime_error(HL_DEBUG + "message is too large to be written in '" + path + "'");
+  }
+}
+
+void OfflineLogWriter::writeSerialized(const char* data, size_t size)
+{
+  if (compressed_writer)
+  {
+    compressed_writer->writeSerialized(data, size);
+  }
+  else if (!writer->writeSerialized(data, size, true))
+  {
+    throw std::runtime_error(HL_DEBUG + "message is too large to be written in '" + path + "'");
+  }
+}
+
+void OfflineLogWriter::setTimeOffset(int64_t time_offset)
+{
+  if (compressed_writer)
+  {
+    compressed_writer->setTimeOffset(time_offset);
+  }
+  else
+  {
+    writer->setTimeOffset(time_offset);
+  }
+}
+
+void OfflineLogWriter::flush()
+{
+  if (compressed_writer)
+  {
+    compressed_writer->flush();
+    return;
+  }
+  writer->flush();
+  if (writer->getStatistics().write_errors > 0)
+  {
+    throw std::runtime_error(HL_DEBUG + "failed to write in '" + path + "'");
+  }
+}
+
+const std::string& OfflineLogWriter::getPath() const
+{
+  return path;
+}
+
+}  // namespace hl_communication
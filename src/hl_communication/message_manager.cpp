@@ -1,11 +1,252 @@
 #include <hl_communication/message_manager.h>
+#include <hl_communication/message_log.h>
 
+#include <google/protobuf/util/message_differencer.h>
+
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <numeric>
 #include <sstream>
 
 namespace hl_communication
 {
+/**
+ * Convert the team_color field of a GCTeamMsg to a TeamColor
+ */
+static MessageManager::TeamColor getColorFromGC(int32_t gc_color)
+{
+  switch (gc_color)
+  {
+    case 0:
+      return MessageManager::BLUE;
+    case 1:
+      return MessageManager::RED;
+    default:
+      return MessageManager::UNKNOWN;
+  }
+}
+
+/**
+ * Return true if both messages describe the same state of the game, time stamps are ignored
+ */
+static bool hasSameGCState(const GCMsg& msg1, const GCMsg& msg2)
+{
+  if (msg1.has_time_stamp() != msg2.has_time_stamp())
+    return false;
+  google::protobuf::util::MessageDifferencer differencer;
+  differencer.IgnoreField(GCMsg::descriptor()->FindFieldByNumber(GCMsg::kTimeStampFieldNumber));
+  differencer.IgnoreField(GCMsg::descriptor()->FindFieldByNumber(GCMsg::kUtcTimeStampFieldNumber));
+  return differencer.Compare(msg1, msg2);
+}
+
+/**
+ * Return the emission utc_time_stamp of the content of the message
+ */
+static uint64_t getMsgTimeStamp(const GameMsg& msg)
+{
+  if (msg.has_robot_msg())
+  {
+    return msg.robot_msg().utc_time_stamp();
+  }
+  return msg.gc_msg().utc_time_stamp();
+}
+
+/**
+ * Set the entry of 'entries' at 'time_stamp', in constant time if it is after the last entry
+ */
+template <typename T>
+static void setEntry(std::map<uint64_t, T>* entries, uint64_t time_stamp, const T& value)
+{
+  if (entries->empty() || entries->rbegin()->first < time_stamp)
+  {
+    entries->emplace_hint(entries->end(), time_stamp, value);
+  }
+  else
+  {
+    (*entries)[time_stamp] = value;
+  }
+}
+
+template <typename T>
+MessageManager::Snapshot::SegmentedHistory<T>::SegmentedHistory() : floor(0)
+{
+}
+
+template <typename T>
+const T* MessageManager::Snapshot::SegmentedHistory<T>::find(uint64_t time_stamp, uint64_t* entry_ts) const
+{
+  const T* result = nullptr;
+  for (const auto& segment : segments)
+  {
+    auto it = segment->upper_bound(time_stamp);
+    if (it == segment->begin())
+      continue;
+    it--;
+    if (it->first < floor)
+      continue;
+    // Most recent segments prevail in case of equality
+    if (result == nullptr || it->first >= *entry_ts)
+    {
+      result = &(it->second);
+      *entry_ts = it->first;
+    }
+  }
+  return result;
+}
+
+template <typename T>
+uint64_t MessageManager::Snapshot::SegmentedHistory<T>::getStart() const
+{
+  uint64_t min_ts = std::numeric_limits<uint64_t>::max();
+  for (const auto& segment : segments)
+  {
+    auto it = segment->lower_bound(floor);
+    if (it != segment->end())
+    {
+      min_ts = std::min(min_ts, it->first);
+    }
+  }
+  return min_ts;
+}
+
+template <typename T>
+uint64_t MessageManager::Snapshot::SegmentedHistory<T>::getEnd() const
+{
+  uint64_t max_ts = 0;
+  for (const auto& segment : segments)
+  {
+    if (segment->rbegin()->first >= floor)
+    {
+      max_ts = std::max(max_ts, segment->rbegin()->first);
+    }
+  }
+  return max_ts;
+}
+
+template <typename T>
+void MessageManager::Snapshot::SegmentedHistory<T>::update(std::map<uint64_t, T>&& entries, uint64_t new_floor)
+{
+  if (new_floor < floor)
+  {
+    // A late message is older than the floor: entries below the current floor have been evicted, they are removed
+    // before lowering the floor so that they do not show up again
+    for (auto& segment : segments)
+    {
+      if (segment->begin()->first < floor)
+      {
+        segment = std::make_shared<const std::map<uint64_t, T>>(segment->lower_bound(floor), segment->end());
+      }
+    }
+    segments.erase(std::remove_if(segments.begin(), segments.end(),
+                                  [](const std::shared_ptr<const std::map<uint64_t, T>>& segment) {
+                                    return segment->empty();
+                                  }),
+                   segments.end());
+  }
+  floor = new_floor;
+  if (!entries.empty())
+  {
+    segments.push_back(std::make_shared<const std::map<uint64_t, T>>(std::move(entries)));
+  }
+  // Merging segments of similar sizes ensures that each entry is copied O(log(n)) times
+  while (segments.size() >= 2 && segments[segments.size() - 2]->size() <= 2 * segments.back()->size())
+  {
+    std::map<uint64_t, T> merged;
+    for (size_t idx = segments.size() - 2; idx < segments.size(); idx++)
+    {
+      for (auto it = segments[idx]->lower_bound(floor); it != segments[idx]->end(); it++)
+      {
+        merged[it->first] = it->second;
+      }
+    }
+    segments.resize(segments.size() - 2);
+    if (!merged.empty())
+    {
+      segments.push_back(std::make_shared<const std::map<uint64_t, T>>(std::move(merged)));
+    }
+  }
+  // Segments which have been fully evicted are released
+  segments.erase(std::remove_if(segments.begin(), segments.end(),
+                                [this](const std::shared_ptr<const std::map<uint64_t, T>>& segment) {
+                                  return segment->rbegin()->first < floor;
+                                }),
+                 segments.end());
+}
+
+MessageManager::Snapshot::Snapshot() : clock_offset(0)
+{
+}
+
+uint64_t MessageManager::Snapshot::getStart() const
+{
+  uint64_t min_ts = gc.getStart();
+  for (const auto& entry : robots)
+  {
+    min_ts = std::min(min_ts, entry.second.getStart());
+  }
+  return min_ts;
+}
+
+uint64_t MessageManager::Snapshot::getEnd() const
+{
+  uint64_t max_ts = gc.getEnd();
+  for (const auto& entry : robots)
+  {
+    max_ts = std::max(max_ts, entry.second.getEnd());
+  }
+  return max_ts;
+}
+
+const RobotStateTable& MessageManager::Snapshot::getRobotStates() const
+{
+  return robot_states;
+}
+
+MessageManager::Status MessageManager::Snapshot::getStatus(uint64_t time_stamp, bool system_clock) const
+{
+  return getStatus(time_stamp, 0, false, system_clock);
+}
+
+MessageManager::Status MessageManager::Snapshot::getStatus(uint64_t time_stamp, uint64_t history_length,
+                                                           bool system_clock) const
+{
+  if (system_clock)
+  {
+    time_stamp -= clock_offset;
+  }
+  return getStatus(time_stamp, time_stamp - history_length, true, false);
+}
+
+MessageManager::Status MessageManager::Snapshot::getStatus(uint64_t time_stamp, uint64_t min_ts, bool use_min_ts,
+                                                           bool system_clock) const
+{
+  if (system_clock)
+  {
+    time_stamp -= clock_offset;
+  }
+  Status status;
+  uint64_t entry_ts = 0;
+  for (const auto& robot_entry : robots)
+  {
+    const RobotMsg* msg = robot_entry.second.find(time_stamp, &entry_ts);
+    if (msg != nullptr && (!use_min_ts || entry_ts >= min_ts))
+    {
+      status.robot_messages[robot_entry.first] = *msg;
+    }
+  }
+  const GCMsg* gc_msg = gc.find(time_stamp, &entry_ts);
+  if (gc_msg != nullptr && (!use_min_ts || entry_ts >= min_ts))
+  {
+    status.gc_message = *gc_msg;
+  }
+  return status;
+}
+
+MessageManager::RetentionPolicy::RetentionPolicy() : max_age(0), max_messages_by_robot(0), max_bytes(0)
+{
+}
+
 std::map<uint32_t, std::vector<RobotMsg>> MessageManager::Status::getRobotsByTeam() const
 {
   std::map<uint32_t, std::vector<RobotMsg>> messages_by_team;
@@ -16,7 +257,17 @@ std::map<uint32_t, std::vector<RobotMsg>> MessageManager::Status::getRobotsByTea
   return messages_by_team;
 }
 
-MessageManager::MessageManager() : clock_offset(0), auto_discover_ports(false)
+MessageManager::MessageManager()
+  : clock_offset(0)
+  , stored_bytes(0)
+  , nb_evictions(0)
+  , lazy_decoding(false)
+  , decoded_cache_size(0)
+  , gc_change_detection(false)
+  , robot_states_enabled(false)
+  , has_main_gc_source(false)
+  , auto_discover_ports(false)
+  , concurrent_readers(false)
 {
 }
 
@@ -49,30 +300,247 @@ void MessageManager::update()
       push(msg);
     }
   }
+  publishSnapshot();
+}
+
+void MessageManager::saveMessages(const std::string& path, bool compressed)
+{
+  std::cout << "Serializing a collection of " << received_messages.size() << " messages" << std::endl;
+  // Messages are streamed to avoid building a copy of the whole collection, records are gathered in large writes
+  OfflineLogWriter writer(path, clock_offset, compressed);
+  for (const auto& entry : received_messages)
+  {
+    writeStored(entry.first, entry.second, &writer);
+  }
+  for (const GCRepeat& repeat : gc_repeats)
+  {
+    writer.write(buildGameMsg(repeat));
+  }
+  writer.flush();
+}
+
+template <typename Writer>
+void MessageManager::writeStored(const MsgIdentifier& msg_id, const GameMsg& msg, Writer* writer) const
+{
+  auto serialized_it = serialized_messages.find(msg_id);
+  if (serialized_it != serialized_messages.end())
+  {
+    writer->writeSerialized(serialized_it->second.data(), serialized_it->second.size());
+  }
+  else
+  {
+    writer->write(msg);
+  }
+}
+
+void MessageManager::startStreamingLog(const std::string& path)
+{
+  streaming_log_error.clear();
+  async_streaming_log.reset();
+  streaming_log.reset(new MessageLogWriter(path, clock_offset));
+  for (const auto& entry : received_messages)
+  {
+    writeStored(entry.first, entry.second, streaming_log.get());
+  }
+  for (const GCRepeat& repeat : gc_repeats)
+  {
+    streaming_log->write(buildGameMsg(repeat));
+  }
+}
+
+void MessageManager::startStreamingLog(const std::string& path, const AsyncMessageLogWriter::Settings& settings)
+{
+  streaming_log_error.clear();
+  streaming_log.reset();
+  async_streaming_log.reset(new AsyncMessageLogWriter(path, clock_offset, settings));
+  // Messages already received are never dropped
+  for (const auto& entry : received_messages)
+  {
+    auto serialized_it = serialized_messages.find(entry.first);
+    if (serialized_it != serialized_messages.end())
+    {
+      async_streaming_log->writeSerialized(serialized_it->second.data(), serialized_it->second.size(), true);
+    }
+    else
+    {
+      async_streaming_log->write(entry.second, true);
+    }
+  }
+  for (const GCRepeat& repeat : gc_repeats)
+  {
+    async_streaming_log->write(buildGameMsg(repeat), true);
+  }
+}
+
+AsyncMessageLogWriter::Statistics MessageManager::getStreamingLogStatistics() const
+{
+  if (!async_streaming_log)
+  {
+    throw std::logic_error(HL_DEBUG + "no streaming log written by a background thread");
+  }
+  return async_streaming_log->getStatistics();
+}
+
+const std::string& MessageManager::getStreamingLogError() const
+{
+  return streaming_log_error;
+}
+
+void MessageManager::stopStreamingLog()
+{
+  streaming_log.reset();
+  async_streaming_log.reset();
+}
+
+void MessageManager::enableConcurrentReaders()
+{
+  if (concurrent_readers)
+    return;
+  if (lazy_decoding)
+  {
+    throw std::logic_error(HL_DEBUG + "concurrent readers are not compatible with lazy decoding");
+  }
+  concurrent_readers = true;
+  std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>(new Snapshot()));
+  // First snapshot contains all the messages received until now
+  pending_robot_messages = messages_by_robot;
+  pending_gc_messages = main_gc_messages;
+  for (const GCRepeat& repeat : gc_repeats)
+  {
+    pending_gc_messages[repeat.utc_time_stamp] = buildGameMsg(repeat).gc_msg();
+  }
+  publishSnapshot();
+}
+
+void MessageManager::enableLazyDecoding(size_t cache_size)
+{
+  if (concurrent_readers)
+  {
+    throw std::logic_error(HL_DEBUG + "lazy decoding is not compatible with concurrent readers");
+  }
+  if (!received_messages.empty())
+  {
+    throw std::logic_error(HL_DEBUG + "lazy decoding should be enabled before storing messages");
+  }
+  lazy_decoding = true;
+  decoded_cache_size = std::max((size_t)1, cache_size);
+}
+
+void MessageManager::enableGCChangeDetection()
+{
+  if (!received_messages.empty())
+  {
+    throw std::logic_error(HL_DEBUG + "GameController change detection should be enabled before storing messages");
+  }
+  gc_change_detection = true;
+}
+
+void MessageManager::enableRobotStates()
+{
+  if (robot_states_enabled)
+    return;
+  robot_states_enabled = true;
+  for (const auto& entry : messages_by_robot)
+  {
+    updateRobotState(entry.first);
+  }
+}
+
+const RobotStateTable& MessageManager::getRobotStates() const
+{
+  if (!robot_states_enabled)
+  {
+    throw std::logic_error(HL_DEBUG + "robot states are not enabled");
+  }
+  return robot_states;
+}
+
+void MessageManager::updateRobotState(const RobotIdentifier& robot_id)
+{
+  if (!robot_states_enabled)
+    return;
+  auto robot_it = messages_by_robot.find(robot_id);
+  if (robot_it == messages_by_robot.end())
+  {
+    robot_states.erase(robot_id.team_id(), robot_id.robot_id());
+    return;
+  }
+  auto last_it = robot_it->second.rbegin();
+  robot_states.update(getRobotState(getRobotMsg(robot_id, last_it->first, last_it->second)));
+}
+
+std::shared_ptr<const MessageManager::Snapshot> MessageManager::getSnapshot() const
+{
+  return std::atomic_load(&snapshot);
 }
 
-void MessageManager::saveMessages(const std::string& path)
+void MessageManager::publishSnapshot()
 {
-  GameMsgCollection collection = buildGameMsgCollection();
-  std::cout << "Serializing a collection of " << collection.messages_size() << " messages" << std::endl;
-  std::ofstream out(path);
-  if (!out.good())
+  if (!concurrent_readers)
+    return;
+  std::shared_ptr<Snapshot> next(new Snapshot(*getSnapshot()));
+  next->clock_offset = clock_offset;
+  if (robot_states_enabled)
+  {
+    // The table holds a row per robot, copying it is cheap
+    next->robot_states = robot_states;
+  }
+  for (auto it = next->robots.begin(); it != next->robots.end();)
+  {
+    if (messages_by_robot.count(it->first) == 0)
+      it = next->robots.erase(it);
+    else
+      it++;
+  }
+  for (auto& entry : pending_robot_messages)
+  {
+    if (messages_by_robot.count(entry.first) > 0)
+    {
+      next->robots[entry.first];
+    }
+  }
+  for (auto& entry : next->robots)
   {
-    throw std::runtime_error("MessageManager: Failed to open file '" + path + "'");
+    // Evicted messages of the robot are older than the first message stored
+    uint64_t floor = messages_by_robot.at(entry.first).begin()->first;
+    TimedRobotMsgCollection new_messages;
+    auto pending_it = pending_robot_messages.find(entry.first);
+    if (pending_it != pending_robot_messages.end())
+    {
+      new_messages = std::move(pending_it->second);
+    }
+    entry.second.update(std::move(new_messages), floor);
+  }
+  uint64_t gc_floor = std::numeric_limits<uint64_t>::max();
+  if (!main_gc_messages.empty())
+  {
+    gc_floor = main_gc_messages.begin()->first;
   }
-  if (!collection.SerializeToOstream(&out))
+  if (!gc_repeats.empty())
   {
-    throw std::runtime_error("MessageManager: Failed to write in '" + path + "'");
+    gc_floor = std::min(gc_floor, gc_repeats.front().utc_time_stamp);
   }
+  next->gc.update(std::move(pending_gc_messages), gc_floor);
+  pending_robot_messages.clear();
+  pending_gc_messages.clear();
+  std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>(next));
 }
 
 uint64_t MessageManager::getStart() const
 {
+  if (concurrent_readers)
+  {
+    return getSnapshot()->getStart();
+  }
   uint64_t min_ts = std::numeric_limits<uint64_t>::max();
   if (main_gc_messages.size() > 0)
   {
     min_ts = std::min(min_ts, main_gc_messages.begin()->first);
   }
+  if (!gc_repeats.empty())
+  {
+    min_ts = std::min(min_ts, gc_repeats.front().utc_time_stamp);
+  }
   for (const auto& robot_collection : messages_by_robot)
   {
     if (robot_collection.second.size() > 0)
@@ -84,12 +552,25 @@ uint64_t MessageManager::getStart() const
 }
 
 uint64_t MessageManager::getEnd() const
+{
+  if (concurrent_readers)
+  {
+    return getSnapshot()->getEnd();
+  }
+  return getHistoryEnd();
+}
+
+uint64_t MessageManager::getHistoryEnd() const
 {
   uint64_t max_ts = 0;
   if (main_gc_messages.size() > 0)
   {
     max_ts = std::max(max_ts, main_gc_messages.rbegin()->first);
   }
+  if (!gc_repeats.empty())
+  {
+    max_ts = std::max(max_ts, gc_repeats.back().utc_time_stamp);
+  }
   for (const auto& robot_collection : messages_by_robot)
   {
     if (robot_collection.second.size() > 0)
@@ -102,43 +583,37 @@ uint64_t MessageManager::getEnd() const
 
 MessageManager::Status MessageManager::getStatus(uint64_t time_stamp, bool system_clock) const
 {
-  if (system_clock)
+  if (concurrent_readers)
   {
-    time_stamp -= clock_offset;
+    return getSnapshot()->getStatus(time_stamp, system_clock);
   }
-  Status status;
-  for (const auto& robot_entry : messages_by_robot)
+  return getStatus(time_stamp, 0, false, system_clock, true);
+}
+
+MessageManager::Status MessageManager::getStatus(uint64_t time_stamp, uint64_t history_length, bool system_clock) const
+{
+  if (concurrent_readers)
   {
-    auto it = robot_entry.second.upper_bound(time_stamp);
-    if (it == robot_entry.second.end())
-      it--;
-    if (it->first > time_stamp)
-    {
-      // Do not include robots which have no data prior to time_stamp
-      if (it == robot_entry.second.begin())
-        continue;
-      it--;
-    }
-    status.robot_messages[robot_entry.first] = it->second;
+    return getSnapshot()->getStatus(time_stamp, history_length, system_clock);
   }
-  if (main_gc_messages.size() > 0)
+  if (system_clock)
   {
-    auto it = main_gc_messages.upper_bound(time_stamp);
-    if (it == main_gc_messages.end())
-      it--;
-    if (it->first > time_stamp)
-    {
-      // There are no data prior to time_stamp
-      if (it == main_gc_messages.begin())
-        return status;
-      it--;
-    }
-    status.gc_message = it->second;
+    time_stamp -= clock_offset;
   }
-  return status;
+  return getStatus(time_stamp, time_stamp - history_length, true, false, true);
 }
 
-MessageManager::Status MessageManager::getStatus(uint64_t time_stamp, uint64_t history_length, bool system_clock) const
+MessageManager::Status MessageManager::getStatusDigest(uint64_t time_stamp, bool system_clock) const
+{
+  if (concurrent_readers)
+  {
+    return getSnapshot()->getStatus(time_stamp, system_clock);
+  }
+  return getStatus(time_stamp, 0, false, system_clock, false);
+}
+
+MessageManager::Status MessageManager::getStatus(uint64_t time_stamp, uint64_t min_ts, bool use_min_ts,
+                                                 bool system_clock, bool decode) const
 {
   if (system_clock)
   {
@@ -157,47 +632,140 @@ MessageManager::Status MessageManager::getStatus(uint64_t time_stamp, uint64_t h
         continue;
       it--;
     }
-    if (it->first >= (time_stamp - history_length))
+    if (!use_min_ts || it->first >= min_ts)
     {
-      status.robot_messages[robot_entry.first] = it->second;
+      status.robot_messages[robot_entry.first] =
+          decode ? getRobotMsg(robot_entry.first, it->first, it->second) : it->second;
     }
   }
-  if (main_gc_messages.size() > 0)
+  GCEntry gc_entry;
+  if (findGCMsg(time_stamp, &gc_entry) && (!use_min_ts || gc_entry.utc_time_stamp >= min_ts))
   {
-    auto it = main_gc_messages.upper_bound(time_stamp);
-    if (it == main_gc_messages.end())
-      it--;
-    if (it->first > time_stamp)
-    {
-      // There are no data prior to time_stamp
-      if (it == main_gc_messages.begin())
-        return status;
-      it--;
-    }
-    if (it->first >= (time_stamp - history_length))
+    exportGCMsg(gc_entry, &status.gc_message);
+  }
+  return status;
+}
+
+bool MessageManager::findGCMsg(uint64_t time_stamp, GCEntry* entry) const
+{
+  auto it = main_gc_messages.upper_bound(time_stamp);
+  auto repeat_it = std::upper_bound(gc_repeats.begin(), gc_repeats.end(), time_stamp,
+                                    [](uint64_t ts, const GCRepeat& repeat) { return ts < repeat.utc_time_stamp; });
+  return getGCEntry(it == main_gc_messages.begin() ? main_gc_messages.end() : std::prev(it),
+                    repeat_it - gc_repeats.begin(), entry);
+}
+
+bool MessageManager::getGCEntry(std::map<uint64_t, GCMsg>::const_iterator msg_it, size_t nb_repeats,
+                                GCEntry* entry) const
+{
+  bool has_msg = msg_it != main_gc_messages.end();
+  bool has_repeat = nb_repeats > 0;
+  if (!has_msg && !has_repeat)
+    return false;
+  // Repeats are never stored with the same utc_time_stamp as the message they repeat
+  if (has_repeat && (!has_msg || gc_repeats[nb_repeats - 1].utc_time_stamp > msg_it->first))
+  {
+    const GCRepeat& repeat = gc_repeats[nb_repeats - 1];
+    entry->utc_time_stamp = repeat.utc_time_stamp;
+    entry->content = repeat.state.get();
+    entry->repeat = &repeat;
+  }
+  else
+  {
+    entry->utc_time_stamp = msg_it->first;
+    entry->content = &(msg_it->second);
+    entry->repeat = nullptr;
+  }
+  return true;
+}
+
+void MessageManager::exportGCMsg(const GCEntry& entry, GCMsg* msg) const
+{
+  *msg = *entry.content;
+  if (entry.repeat != nullptr)
+  {
+    if (msg->has_time_stamp())
     {
-      status.gc_message = it->second;
+      msg->set_time_stamp(entry.repeat->time_stamp);
     }
+    msg->set_utc_time_stamp(entry.repeat->utc_time_stamp);
   }
-  return status;
+}
+
+GameMsg MessageManager::buildGameMsg(const GCRepeat& repeat) const
+{
+  GameMsg msg;
+  GCEntry entry;
+  entry.utc_time_stamp = repeat.utc_time_stamp;
+  entry.content = repeat.state.get();
+  entry.repeat = &repeat;
+  exportGCMsg(entry, msg.mutable_gc_msg());
+  MsgIdentifier* identifier = msg.mutable_identifier();
+  identifier->set_packet_no(repeat.packet_no);
+  identifier->set_src_ip(main_gc_source.src_ip);
+  identifier->set_src_port(main_gc_source.src_port);
+  return msg;
+}
+
+const RobotMsg& MessageManager::getRobotMsg(const RobotIdentifier& robot_id, uint64_t utc_ts,
+                                            const RobotMsg& stored) const
+{
+  if (!lazy_decoding)
+    return stored;
+  const MsgIdentifier& msg_id = findRobotMsg(robot_id, utc_ts)->second;
+  auto index_it = decoded_cache_index.find(msg_id);
+  if (index_it != decoded_cache_index.end())
+  {
+    decoded_cache.splice(decoded_cache.begin(), decoded_cache, index_it->second);
+    return index_it->second->second;
+  }
+  auto serialized_it = serialized_messages.find(msg_id);
+  if (serialized_it == serialized_messages.end())
+  {
+    // Message is already stored decoded
+    return stored;
+  }
+  GameMsg msg;
+  if (!msg.ParseFromString(serialized_it->second))
+  {
+    throw std::runtime_error(HL_DEBUG + "failed to decode a stored RobotMsg");
+  }
+  decoded_cache.emplace_front(msg_id, std::move(*msg.mutable_robot_msg()));
+  decoded_cache_index[msg_id] = decoded_cache.begin();
+  if (decoded_cache.size() > decoded_cache_size)
+  {
+    decoded_cache_index.erase(decoded_cache.back().first);
+    decoded_cache.pop_back();
+  }
+  return decoded_cache.front().second;
+}
+
+std::multimap<uint64_t, MsgIdentifier>::const_iterator MessageManager::findRobotMsg(const RobotIdentifier& robot_id,
+                                                                                    uint64_t utc_ts) const
+{
+  auto robot_it = robot_msg_entries.find(robot_id);
+  if (robot_it != robot_msg_entries.end())
+  {
+    auto entry_it = robot_it->second.find(utc_ts);
+    if (entry_it != robot_it->second.end())
+      return entry_it->second;
+  }
+  throw std::logic_error(HL_DEBUG + "robot message is not indexed by time");
 }
 
 MessageManager::TeamColor MessageManager::getTeamColor(uint64_t utc_ts, const RobotIdentifier& robot_id) const
 {
-  Status status = getStatus(utc_ts);
-  for (const GCTeamMsg& team_msg : status.gc_message.teams())
+  GCEntry entry;
+  if (!findGCMsg(utc_ts, &entry))
+  {
+    // There are no data prior to utc_ts
+    return UNKNOWN;
+  }
+  for (const GCTeamMsg& team_msg : entry.content->teams())
   {
     if (team_msg.team_number() == (int32_t)robot_id.team_id())
     {
-      switch (team_msg.team_color())
-      {
-        case 0:
-          return BLUE;
-        case 1:
-          return RED;
-        default:
-          return UNKNOWN;
-      }
+      return getColorFromGC(team_msg.team_color());
     }
   }
   return UNKNOWN;
@@ -219,7 +787,16 @@ void MessageManager::push(const RobotMsg& msg)
     throw std::runtime_error("MessageManager can only handle utc time_stamped RobotMsg");
   }
   const RobotIdentifier& robot_id = msg.robot_id();
-  messages_by_robot[robot_id][msg.utc_time_stamp()] = msg;
+  setEntry(&messages_by_robot[robot_id], msg.utc_time_stamp(), msg);
+  if (concurrent_readers)
+  {
+    setEntry(&pending_robot_messages[robot_id], msg.utc_time_stamp(), msg);
+  }
+}
+
+void MessageManager::updateRobotColor(const RobotMsg& msg)
+{
+  const RobotIdentifier& robot_id = msg.robot_id();
   TeamColor new_team_color = getTeamColor(msg.utc_time_stamp(), robot_id);
   if (active_robots_colors.count(robot_id) == 0)
   {
@@ -243,7 +820,11 @@ void MessageManager::push(const GCMsg& msg, bool isWantedMessage)
   }
   if (isWantedMessage)
   {
-    main_gc_messages[msg.utc_time_stamp()] = msg;
+    setEntry(&main_gc_messages, msg.utc_time_stamp(), msg);
+    if (concurrent_readers)
+    {
+      setEntry(&pending_gc_messages, msg.utc_time_stamp(), msg);
+    }
     for (const GCTeamMsg& team_msg : msg.teams())
     {
       int team_id = team_msg.team_number();
@@ -284,19 +865,169 @@ void MessageManager::openReceiver(int port)
 
 bool MessageManager::hasMainGCSource()
 {
-  return !main_gc_messages.empty();
+  return has_main_gc_source;
 }
 
 void MessageManager::push(const GameMsg& msg)
+{
+  const GameMsg* stored_msg;
+  if (lazy_decoding && msg.has_robot_msg())
+  {
+    std::string serialized = msg.SerializeAsString();
+    GameMsg digest;
+    if (!parseGameMsgDigest(serialized.data(), serialized.size(), &digest))
+    {
+      throw std::runtime_error(HL_DEBUG + "failed to extract the digest of a GameMsg");
+    }
+    stored_msg = store(std::move(digest), std::move(serialized));
+  }
+  else
+  {
+    stored_msg = store(GameMsg(msg), std::string());
+  }
+  if (stored_msg != nullptr && stored_msg->has_robot_msg())
+  {
+    const RobotMsg& robot_msg = stored_msg->robot_msg();
+    updateRobotColor(robot_msg);
+    // The received message is complete even if a digest has been stored
+    uint64_t last_ts = messages_by_robot.at(robot_msg.robot_id()).rbegin()->first;
+    if (robot_states_enabled && last_ts == robot_msg.utc_time_stamp())
+    {
+      robot_states.update(getRobotState(msg.robot_msg()));
+    }
+  }
+  enforceRetention();
+}
+
+void MessageManager::push(std::vector<GameMsg>&& messages)
+{
+  // Empty serialized contents: messages are stored as is
+  std::vector<std::string> serialized(messages.size());
+  push(std::move(messages), std::move(serialized));
+}
+
+void MessageManager::push(std::vector<GameMsg>&& digests, std::vector<std::string>&& serialized)
+{
+  size_t nb_messages = digests.size();
+  // As when messages are pushed one at a time, the source of the first GameController message is the main one
+  if (!hasMainGCSource())
+  {
+    for (const GameMsg& msg : digests)
+    {
+      if (msg.has_gc_msg())
+      {
+        main_gc_source.src_ip = msg.identifier().src_ip();
+        main_gc_source.src_port = msg.identifier().src_port();
+        has_main_gc_source = true;
+        break;
+      }
+    }
+  }
+  // Ordered by identifier: duplicates are adjacent and received_messages is filled with hinted insertions
+  std::vector<size_t> by_id(nb_messages);
+  std::iota(by_id.begin(), by_id.end(), 0);
+  std::stable_sort(by_id.begin(), by_id.end(),
+                   [&digests](size_t a, size_t b) { return digests[a].identifier() < digests[b].identifier(); });
+  std::vector<uint8_t> stored(nb_messages, 0);
+  std::vector<std::map<MsgIdentifier, GameMsg>::iterator> positions(nb_messages);
+  const MsgIdentifier* previous_id = nullptr;
+  for (size_t idx : by_id)
+  {
+    const MsgIdentifier& msg_id = digests[idx].identifier();
+    auto position = received_messages.lower_bound(msg_id);
+    if ((position != received_messages.end() && !(msg_id < position->first)) ||
+        (previous_id != nullptr && !(*previous_id < msg_id)))
+    {
+      std::cerr << "Duplicated message received" << std::endl;
+      continue;
+    }
+    previous_id = &msg_id;
+    stored[idx] = 1;
+    positions[idx] = position;
+  }
+  // Ordered by time: repeats are detected against the state in force and the containers indexed by time are filled
+  // at their end
+  std::vector<size_t> by_time;
+  by_time.reserve(nb_messages);
+  for (size_t idx = 0; idx < nb_messages; idx++)
+  {
+    if (stored[idx])
+    {
+      by_time.push_back(idx);
+    }
+  }
+  std::vector<uint64_t> time_stamps(nb_messages, 0);
+  for (size_t idx : by_time)
+  {
+    time_stamps[idx] = getMsgTimeStamp(digests[idx]);
+  }
+  std::stable_sort(by_time.begin(), by_time.end(),
+                   [&time_stamps](size_t a, size_t b) { return time_stamps[a] < time_stamps[b]; });
+  for (size_t idx : by_time)
+  {
+    if (storeGCRepeat(digests[idx]))
+    {
+      stored[idx] = 0;
+    }
+    else
+    {
+      indexByTime(digests[idx]);
+    }
+  }
+  std::vector<const GameMsg*> stored_messages(nb_messages, nullptr);
+  for (size_t idx : by_id)
+  {
+    if (!stored[idx])
+      continue;
+    MsgIdentifier msg_id = digests[idx].identifier();
+    auto position = received_messages.emplace_hint(positions[idx], msg_id, std::move(digests[idx]));
+    storeContent(position->first, position->second, std::move(serialized[idx]));
+    stored_messages[idx] = &position->second;
+  }
+  digests.clear();
+  serialized.clear();
+  // Colors are resolved in time order once all the GameController messages are known
+  std::set<RobotIdentifier> updated_robots;
+  for (size_t idx : by_time)
+  {
+    if (stored_messages[idx] != nullptr && stored_messages[idx]->has_robot_msg())
+    {
+      const RobotMsg& robot_msg = stored_messages[idx]->robot_msg();
+      updateRobotColor(robot_msg);
+      updated_robots.insert(robot_msg.robot_id());
+    }
+  }
+  // Only the last message of each robot is converted
+  for (const RobotIdentifier& robot_id : updated_robots)
+  {
+    updateRobotState(robot_id);
+  }
+  enforceRetention();
+}
+
+const GameMsg* MessageManager::store(GameMsg&& new_msg, std::string&& serialized)
 {
   // Avoid to store twice duplicated message and print warning
-  if (received_messages.count(msg.identifier()) > 0)
+  MsgIdentifier msg_id = new_msg.identifier();
+  auto position = received_messages.lower_bound(msg_id);
+  if (position != received_messages.end() && !(msg_id < position->first))
   {
     std::cerr << "Duplicated message received" << std::endl;
     // TODO: show message identifier
-    return;
+    return nullptr;
+  }
+  if (storeGCRepeat(new_msg))
+  {
+    return nullptr;
   }
-  received_messages[msg.identifier()] = msg;
+  position = received_messages.emplace_hint(position, msg_id, std::move(new_msg));
+  indexByTime(position->second);
+  storeContent(position->first, position->second, std::move(serialized));
+  return &position->second;
+}
+
+void MessageManager::indexByTime(const GameMsg& msg)
+{
   if (msg.has_robot_msg())
   {
     push(msg.robot_msg());
@@ -310,6 +1041,7 @@ void MessageManager::push(const GameMsg& msg)
     if (!hasMainGCSource())
     {
       main_gc_source = source_id;
+      has_main_gc_source = true;
       push(msg.gc_msg(), true);
     }
     else
@@ -344,52 +1076,167 @@ void MessageManager::push(const GameMsg& msg)
   {
     throw std::runtime_error("Failed to read GameMsg, not a RobotMsg neither a GCMsg");
   }
+  // Messages are mostly received in order, the hint makes their insertion constant time
+  std::multimap<uint64_t, MsgIdentifier>::const_iterator time_it =
+      received_by_time.insert(received_by_time.end(), { getMsgTimeStamp(msg), msg.identifier() });
+  if (msg.has_robot_msg())
+  {
+    const RobotMsg& robot_msg = msg.robot_msg();
+    setEntry(&robot_msg_entries[robot_msg.robot_id()], robot_msg.utc_time_stamp(), time_it);
+  }
+  else
+  {
+    SourceIdentifier source_id;
+    source_id.src_ip = msg.identifier().src_ip();
+    source_id.src_port = msg.identifier().src_port();
+    setEntry(source_id != main_gc_source ? &interfering_gc_entries : &main_gc_entries, msg.gc_msg().utc_time_stamp(),
+             time_it);
+  }
 }
 
-void MessageManager::push(const GameMsgCollection& collection)
+void MessageManager::storeContent(const MsgIdentifier& msg_id, const GameMsg& msg, std::string&& serialized)
 {
-  for (const GameMsg& msg : collection.messages())
+  if (serialized.empty())
   {
-    push(msg);
+    stored_bytes += msg.ByteSizeLong();
   }
+  else
+  {
+    stored_bytes += serialized.size();
+    serialized_messages.emplace_hint(serialized_messages.end(), msg_id, std::move(serialized));
+  }
+  streamMessage(msg_id, msg);
 }
 
-void MessageManager::loadMessages(const std::string& file_path)
+void MessageManager::streamMessage(const MsgIdentifier& msg_id, const GameMsg& msg)
+{
+  try
+  {
+    if (streaming_log)
+    {
+      writeStored(msg_id, msg, streaming_log.get());
+    }
+    else if (async_streaming_log)
+    {
+      writeStored(msg_id, msg, async_streaming_log.get());
+    }
+  }
+  catch (const std::runtime_error& exc)
+  {
+    // The message is already stored, throwing would leave the caller with a partially applied push
+    streaming_log_error = exc.what();
+    std::cerr << HL_DEBUG << "streaming log stopped: " << streaming_log_error << std::endl;
+    streaming_log.reset();
+    async_streaming_log.reset();
+  }
+}
+
+bool MessageManager::storeGCRepeat(const GameMsg& msg)
 {
-  std::ifstream in(file_path, std::ios::binary);
-  if (!in.good())
+  if (!gc_change_detection || !msg.has_gc_msg() || !hasMainGCSource())
+    return false;
+  SourceIdentifier source_id;
+  source_id.src_ip = msg.identifier().src_ip();
+  source_id.src_port = msg.identifier().src_port();
+  const GCMsg& gc_msg = msg.gc_msg();
+  if (source_id != main_gc_source || !gc_msg.has_utc_time_stamp())
+    return false;
+  uint64_t utc_ts = gc_msg.utc_time_stamp();
+  // Duplicates are checked first: the state in force at utc_ts would be the repeat itself
+  auto position = std::upper_bound(gc_repeats.begin(), gc_repeats.end(), utc_ts,
+                                   [](uint64_t ts, const GCRepeat& repeat) { return ts < repeat.utc_time_stamp; });
+  for (auto it = position; it != gc_repeats.begin() && (it - 1)->utc_time_stamp == utc_ts; it--)
+  {
+    if ((it - 1)->packet_no == msg.identifier().packet_no())
+    {
+      std::cerr << "Duplicated message received" << std::endl;
+      return true;
+    }
+  }
+  GCEntry entry;
+  if (!findGCMsg(utc_ts, &entry) || entry.utc_time_stamp >= utc_ts || !hasSameGCState(*entry.content, gc_msg))
+    return false;
+  GCRepeat repeat;
+  repeat.utc_time_stamp = utc_ts;
+  repeat.time_stamp = gc_msg.time_stamp();
+  repeat.packet_no = msg.identifier().packet_no();
+  if (entry.repeat != nullptr)
   {
-    throw std::runtime_error("Failed to open file at '" + file_path + "'");
+    repeat.state = entry.repeat->state;
   }
-  GameMsgCollection messages_collection;
-  if (!messages_collection.ParseFromIstream(&in))
+  else
   {
-    throw std::runtime_error("Failed to parse messages in file '" + file_path + "'");
+    // The state is shared by all the repeats of the transition and created with the first one
+    std::shared_ptr<const GCMsg>& state = gc_repeated_states[entry.utc_time_stamp];
+    if (!state)
+    {
+      state = std::make_shared<const GCMsg>(*entry.content);
+    }
+    repeat.state = state;
   }
-  if (messages_collection.has_time_offset())
+  gc_repeats.insert(position, std::move(repeat));
+  stored_bytes += sizeof(GCRepeat);
+  if (concurrent_readers)
   {
-    setOffset(messages_collection.time_offset());
+    pending_gc_messages[utc_ts] = gc_msg;
   }
-  std::cout << "Pushing " << messages_collection.messages_size() << " messages in MM" << std::endl;
-  for (const GameMsg msg : messages_collection.messages())
+  streamMessage(msg.identifier(), msg);
+  return true;
+}
+
+void MessageManager::push(const GameMsgCollection& collection)
+{
+  for (const GameMsg& msg : collection.messages())
   {
     push(msg);
   }
 }
 
-GameMsgCollection MessageManager::buildGameMsgCollection() const
+void MessageManager::loadMessages(const std::string& file_path)
 {
-  GameMsgCollection result;
-  for (const auto& entry : received_messages)
+  std::vector<GameMsg> messages;
+  std::vector<std::string> serialized;
+  GameMsgCollection header;
+  if (lazy_decoding)
   {
-    result.add_messages()->CopyFrom(entry.second);
+    readGameMsgDigests(file_path, &messages, &serialized, &header);
   }
-  return result;
+  else
+  {
+    readGameMsgs(file_path, &messages, &header);
+  }
+  if (header.has_time_offset())
+  {
+    setOffset(header.time_offset());
+  }
+  std::cout << "Pushing " << messages.size() << " messages in MM" << std::endl;
+  if (lazy_decoding)
+  {
+    push(std::move(messages), std::move(serialized));
+  }
+  else
+  {
+    push(std::move(messages));
+  }
+  publishSnapshot();
 }
 
 void MessageManager::setOffset(int64_t new_offset)
 {
   clock_offset = new_offset;
+  if (spill_log)
+  {
+    spill_log->setTimeOffset(clock_offset);
+  }
+  if (streaming_log)
+  {
+    streaming_log->setTimeOffset(clock_offset);
+  }
+  else if (async_streaming_log)
+  {
+    async_streaming_log->setTimeOffset(clock_offset);
+  }
+  publishSnapshot();
 }
 
 int64_t MessageManager::getOffset() const
@@ -397,6 +1244,186 @@ int64_t MessageManager::getOffset() const
   return clock_offset;
 }
 
+void MessageManager::setRetentionPolicy(const RetentionPolicy& policy)
+{
+  if (policy.spill_path == "")
+  {
+    spill_log.reset();
+  }
+  else if (!spill_log || spill_log->getPath() != policy.spill_path)
+  {
+    spill_log.reset(new MessageLogWriter(policy.spill_path, clock_offset));
+  }
+  retention_policy = policy;
+  enforceRetention();
+  publishSnapshot();
+}
+
+const MessageManager::RetentionPolicy& MessageManager::getRetentionPolicy() const
+{
+  return retention_policy;
+}
+
+size_t MessageManager::getStoredBytes() const
+{
+  return stored_bytes;
+}
+
+void MessageManager::enforceRetention()
+{
+  if (retention_policy.max_age > 0)
+  {
+    uint64_t end = getHistoryEnd();
+    // getOldestTimeStamp is max uint64_t once everything has been evicted
+    for (uint64_t oldest = getOldestTimeStamp(); oldest < end && oldest + retention_policy.max_age < end;
+         oldest = getOldestTimeStamp())
+    {
+      evictOldest();
+    }
+  }
+  if (retention_policy.max_messages_by_robot > 0)
+  {
+    for (auto robot_it = messages_by_robot.begin(); robot_it != messages_by_robot.end();)
+    {
+      // Evicting the last message of a robot removes its entry, iterator is updated before
+      const RobotIdentifier robot_id = robot_it->first;
+      size_t nb_messages = robot_it->second.size();
+      robot_it++;
+      for (; nb_messages > retention_policy.max_messages_by_robot; nb_messages--)
+      {
+        uint64_t oldest_ts = messages_by_robot.at(robot_id).begin()->first;
+        evict(findRobotMsg(robot_id, oldest_ts));
+      }
+    }
+  }
+  if (retention_policy.max_bytes > 0)
+  {
+    bool evicted = true;
+    while (evicted && stored_bytes > retention_policy.max_bytes)
+    {
+      evicted = evictOldest();
+    }
+  }
+}
+
+bool MessageManager::evictOldest()
+{
+  bool has_msg = !received_by_time.empty();
+  bool has_repeat = !gc_repeats.empty();
+  if (!has_msg && !has_repeat)
+    return false;
+  if (has_msg && (!has_repeat || received_by_time.begin()->first <= gc_repeats.front().utc_time_stamp))
+  {
+    evict(received_by_time.begin());
+    return true;
+  }
+  if (spill_log)
+  {
+    spill_log->write(buildGameMsg(gc_repeats.front()));
+  }
+  stored_bytes -= sizeof(GCRepeat);
+  gc_repeats.pop_front();
+  nb_evictions++;
+  return true;
+}
+
+uint64_t MessageManager::getOldestTimeStamp() const
+{
+  uint64_t oldest = std::numeric_limits<uint64_t>::max();
+  if (!received_by_time.empty())
+  {
+    oldest = received_by_time.begin()->first;
+  }
+  if (!gc_repeats.empty())
+  {
+    oldest = std::min(oldest, gc_repeats.front().utc_time_stamp);
+  }
+  return oldest;
+}
+
+void MessageManager::evict(std::multimap<uint64_t, MsgIdentifier>::const_iterator it)
+{
+  auto msg_it = received_messages.find(it->second);
+  const GameMsg& msg = msg_it->second;
+  uint64_t utc_ts = it->first;
+  if (spill_log)
+  {
+    writeStored(msg_it->first, msg, spill_log.get());
+  }
+  if (msg.has_robot_msg())
+  {
+    const RobotIdentifier& robot_id = msg.robot_msg().robot_id();
+    // The message has been replaced in messages_by_robot if another one was received with the same utc_time_stamp
+    bool is_stored = false;
+    auto entries_it = robot_msg_entries.find(robot_id);
+    if (entries_it != robot_msg_entries.end())
+    {
+      auto entry_it = entries_it->second.find(utc_ts);
+      if (entry_it != entries_it->second.end() && entry_it->second == it)
+      {
+        is_stored = true;
+        entries_it->second.erase(entry_it);
+        if (entries_it->second.empty())
+        {
+          robot_msg_entries.erase(entries_it);
+        }
+      }
+    }
+    if (is_stored)
+    {
+      auto robot_it = messages_by_robot.find(robot_id);
+      bool is_last = robot_it->second.rbegin()->first == utc_ts;
+      robot_it->second.erase(utc_ts);
+      // Robots without messages are not expected by getStatus
+      if (robot_it->second.empty())
+      {
+        messages_by_robot.erase(robot_it);
+      }
+      if (is_last)
+      {
+        updateRobotState(robot_id);
+      }
+    }
+  }
+  else
+  {
+    // As for robots, the state is only erased if it was not replaced by a message with the same utc_time_stamp
+    auto main_it = main_gc_entries.find(utc_ts);
+    auto interfering_it = interfering_gc_entries.find(utc_ts);
+    if (main_it != main_gc_entries.end() && main_it->second == it)
+    {
+      main_gc_entries.erase(main_it);
+      main_gc_messages.erase(utc_ts);
+      // Repeats of the message keep their own reference to the state
+      gc_repeated_states.erase(utc_ts);
+    }
+    else if (interfering_it != interfering_gc_entries.end() && interfering_it->second == it)
+    {
+      interfering_gc_entries.erase(interfering_it);
+      interfering_gc_messages.erase(utc_ts);
+    }
+  }
+  auto serialized_it = serialized_messages.find(msg_it->first);
+  if (serialized_it == serialized_messages.end())
+  {
+    stored_bytes -= msg.ByteSizeLong();
+  }
+  else
+  {
+    stored_bytes -= serialized_it->second.size();
+    serialized_messages.erase(serialized_it);
+    auto index_it = decoded_cache_index.find(msg_it->first);
+    if (index_it != decoded_cache_index.end())
+    {
+      decoded_cache.erase(index_it->second);
+      decoded_cache_index.erase(index_it);
+    }
+  }
+  received_messages.erase(msg_it);
+  received_by_time.erase(it);
+  nb_evictions++;
+}
+
 bool operator<(const MessageManager::SourceIdentifier& id1, const MessageManager::SourceIdentifier& id2)
 {
   if (id1.src_ip != id2.src_ip)
@@ -0,0 +1,122 @@
+#include <hl_communication/perception_in_field.h>
+
+#include <cmath>
+
+namespace hl_communication
+{
+bool getCovariance(const PositionDistribution& position, Eigen::Matrix2d* covariance)
+{
+  int nb_coeffs = position.uncertainty_size();
+  if (nb_coeffs != 2 && nb_coeffs != 3)
+    return false;
+  double var_x, var_xy, var_y;
+  if (nb_coeffs == 2)
+  {
+    // Standard deviations along x and y
+    var_x = std::pow(position.uncertainty(0), 2);
+    var_xy = 0;
+    var_y = std::pow(position.uncertainty(1), 2);
+  }
+  else
+  {
+    var_x = position.uncertainty(0);
+    var_xy = position.uncertainty(1);
+    var_y = position.uncertainty(2);
+  }
+  *covariance << var_x, var_xy, var_xy, var_y;
+  return true;
+}
+
+/**
+ * Transformation from the self basis of a robot to the field, shared by all the objects of its perception
+ */
+class SelfToField
+{
+public:
+  SelfToField(const PoseDistribution& self_in_field)
+  {
+    dir = self_in_field.dir().mean();
+    double cos_dir = std::cos(dir);
+    double sin_dir = std::sin(dir);
+    rotation << cos_dir, -sin_dir, sin_dir, cos_dir;
+    translation = Eigen::Vector2d(self_in_field.position().x(), self_in_field.position().y());
+    if (!getCovariance(self_in_field.position(), &translation_covariance))
+    {
+      translation_covariance.setZero();
+    }
+    dir_variance = std::pow(self_in_field.dir().std_dev(), 2);
+  }
+
+  void transform(const PositionDistribution& pos_in_self, FieldPosition* result) const
+  {
+    Eigen::Vector2d pos(pos_in_self.x(), pos_in_self.y());
+    result->position = translation + rotation * pos;
+    // Jacobian of the position in field with respect to the direction of the robot
+    Eigen::Vector2d dir_jacobian(-rotation(1, 0) * pos.x() - rotation(0, 0) * pos.y(),
+                                 rotation(0, 0) * pos.x() - rotation(1, 0) * pos.y());
+    result->covariance = translation_covariance + dir_variance * dir_jacobian * dir_jacobian.transpose();
+    Eigen::Matrix2d covariance_in_self;
+    if (getCovariance(pos_in_self, &covariance_in_self))
+    {
+      result->covariance += rotation * covariance_in_self * rotation.transpose();
+    }
+  }
+
+  void transform(const PoseDistribution& pose_in_self, FieldRobot* result) const
+  {
+    transform(pose_in_self.position(), &result->position);
+    result->dir = dir + pose_in_self.dir().mean();
+    result->dir_std_dev = std::sqrt(dir_variance + std::pow(pose_in_self.dir().std_dev(), 2));
+  }
+
+private:
+  double dir;
+  Eigen::Matrix2d rotation;
+  Eigen::Vector2d translation;
+  Eigen::Matrix2d translation_covariance;
+  double dir_variance;
+};
+
+void fieldFromSelf(const PoseDistribution& self_in_field, const Perception& perception, PerceptionInField* result)
+{
+  SelfToField self_to_field(self_in_field);
+  result->has_ball = perception.has_ball_in_self();
+  if (result->has_ball)
+  {
+    self_to_field.transform(perception.ball_in_self(), &result->ball);
+  }
+  result->has_opp_goal = perception.has_opp_goal_in_self();
+  if (result->has_opp_goal)
+  {
+    self_to_field.transform(perception.opp_goal_in_self(), &result->opp_goal);
+  }
+  result->robots.resize(perception.robots_size());
+  for (int idx = 0; idx < perception.robots_size(); idx++)
+  {
+    const WeightedRobotPose& weighted_robot = perception.robots(idx);
+    const RobotEstimation& robot = weighted_robot.robot();
+    FieldRobot& robot_in_field = result->robots[idx];
+    robot_in_field.probability = weighted_robot.probability();
+    robot_in_field.team_id = robot.robot_id().team_id();
+    robot_in_field.robot_id = robot.robot_id().robot_id();
+    self_to_field.transform(robot.robot_in_self(), &robot_in_field);
+  }
+}
+
+bool getPerceptionInField(const RobotMsg& msg, PerceptionInField* result)
+{
+  const WeightedPose* best_pose = nullptr;
+  for (const WeightedPose& pose : msg.perception().self_in_field())
+  {
+    if (best_pose == nullptr || pose.probability() > best_pose->probability())
+    {
+      best_pose = &pose;
+    }
+  }
+  if (best_pose == nullptr)
+    return false;
+  fieldFromSelf(best_pose->pose(), msg.perception(), result);
+  return true;
+}
+
+}  // namespace hl_communication
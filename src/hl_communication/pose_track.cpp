@@ -0,0 +1,138 @@
+#include <hl_communication/pose_track.h>
+
+#include <hl_communication/utils.h>
+
+#include <algorithm>
+
+namespace hl_communication
+{
+/**
+ * Interpolate between poses 'a' (ratio 0) and 'b' (ratio 1): slerp for the orientation and linear interpolation of the
+ * position of the camera in the field, which follows the path of the camera unlike the translation of the poses
+ */
+static Eigen::Affine3d interpolate(const Eigen::Affine3d& a, const Eigen::Affine3d& b, double ratio)
+{
+  Eigen::Quaterniond rotation_a(a.linear());
+  Eigen::Quaterniond rotation_b(b.linear());
+  Eigen::Vector3d camera_a = -a.linear().transpose() * a.translation();
+  Eigen::Vector3d camera_b = -b.linear().transpose() * b.translation();
+  Eigen::Matrix3d rotation = rotation_a.slerp(ratio, rotation_b).toRotationMatrix();
+  Eigen::Vector3d camera_in_field = (1 - ratio) * camera_a + ratio * camera_b;
+  Eigen::Affine3d result = Eigen::Affine3d::Identity();
+  result.linear() = rotation;
+  result.translation() = -rotation * camera_in_field;
+  return result;
+}
+
+PoseTrack::PoseTrack(const VideoMetaInformation& meta_information, bool utc_)
+  : utc(utc_), frame_index(meta_information)
+{
+  int nb_frames = meta_information.frames_size();
+  status.resize(nb_frames);
+  known.resize(nb_frames, 0);
+  poses.resize(nb_frames, Eigen::Affine3d::Identity());
+  bool has_default = meta_information.has_default_pose();
+  Eigen::Affine3d default_pose =
+      has_default ? getAffineFromProtobuf(meta_information.default_pose()) : Eigen::Affine3d::Identity();
+  // Index of the next frame with a pose, frames without time stamp can't be used for interpolation
+  std::vector<int> next_pose(nb_frames + 1, -1);
+  for (int index = nb_frames - 1; index >= 0; index--)
+  {
+    const FrameEntry& frame = meta_information.frames(index);
+    status[index] = frame.status();
+    next_pose[index] = next_pose[index + 1];
+    if (frame.has_pose())
+    {
+      known[index] = 1;
+      poses[index] = getAffineFromProtobuf(frame.pose());
+      if (utc ? frame.has_utc_ts() : frame.has_monotonic_ts())
+      {
+        next_pose[index] = index;
+      }
+    }
+  }
+  int previous_pose = -1;
+  for (int index = 0; index < nb_frames; index++)
+  {
+    const FrameEntry& frame = meta_information.frames(index);
+    if (frame.has_pose())
+    {
+      if (next_pose[index] == index)
+      {
+        previous_pose = index;
+      }
+      continue;
+    }
+    bool has_ts = utc ? frame.has_utc_ts() : frame.has_monotonic_ts();
+    int next = next_pose[index];
+    if (status[index] == FrameStatus::STATIC && index > 0 && known[index - 1])
+    {
+      known[index] = 1;
+      poses[index] = poses[index - 1];
+    }
+    else if ((status[index] == FrameStatus::MOVING || status[index] == FrameStatus::UNKNOWN_FRAME_STATUS) && has_ts &&
+             previous_pose >= 0 && next >= 0)
+    {
+      uint64_t start = frame_index.getTimeStamp(previous_pose, utc);
+      uint64_t end = frame_index.getTimeStamp(next, utc);
+      uint64_t time_stamp = frame_index.getTimeStamp(index, utc);
+      // Time stamps are not necessarily sorted
+      double ratio = end > start ? ((double)time_stamp - start) / (end - start) : 0;
+      known[index] = 1;
+      poses[index] = interpolate(poses[previous_pose], poses[next], std::min(1.0, std::max(0.0, ratio)));
+    }
+    else if (has_default)
+    {
+      known[index] = 1;
+      poses[index] = default_pose;
+    }
+  }
+}
+
+bool PoseTrack::isInterpolable(int index) const
+{
+  return known[index] && status[index] != FrameStatus::SHAKING;
+}
+
+bool PoseTrack::getPose(uint64_t time_stamp, Eigen::Affine3d* pose) const
+{
+  int index = frame_index.getIndex(time_stamp, utc);
+  if (index < 0 || !known[index])
+    return false;
+  int next = index + 1;
+  uint64_t start = frame_index.getTimeStamp(index, utc);
+  if (start == time_stamp || next >= frame_index.getNbFrames() || !isInterpolable(index) || !isInterpolable(next))
+  {
+    *pose = poses[index];
+    return true;
+  }
+  // getIndex has read the time stamp of the next frame, it is greater than time_stamp
+  uint64_t end = frame_index.getTimeStamp(next, utc);
+  *pose = interpolate(poses[index], poses[next], (double)(time_stamp - start) / (end - start));
+  return true;
+}
+
+Eigen::Affine3d PoseTrack::getPose(uint64_t time_stamp) const
+{
+  Eigen::Affine3d pose;
+  if (!getPose(time_stamp, &pose))
+  {
+    throw std::runtime_error(HL_DEBUG + " no pose available at " + std::to_string(time_stamp));
+  }
+  return pose;
+}
+
+bool PoseTrack::getFramePose(int index, Eigen::Affine3d* pose) const
+{
+  if (index < 0 || index >= frame_index.getNbFrames())
+  {
+    throw std::out_of_range(HL_DEBUG + " invalid index: " + std::to_string(index) +
+                            " (nb frames: " + std::to_string(frame_index.getNbFrames()) + ")");
+  }
+  if (!known[index])
+    return false;
+  *pose = poses[index];
+  return true;
+}
+
+}  // namespace hl_communication
@@ -0,0 +1,216 @@
+#include <hl_communication/robot_state.h>
+
+#include <cmath>
+#include <limits>
+
+namespace hl_communication
+{
+RobotState getRobotState(const RobotMsg& msg)
+{
+  RobotState state = RobotState();
+  state.team_id = msg.robot_id().team_id();
+  state.robot_id = msg.robot_id().robot_id();
+  state.time_stamp = msg.time_stamp();
+  state.utc_time_stamp = msg.utc_time_stamp();
+  if (msg.has_perception())
+  {
+    const Perception& perception = msg.perception();
+    const WeightedPose* best_pose = nullptr;
+    for (const WeightedPose& pose : perception.self_in_field())
+    {
+      if (best_pose == nullptr || pose.probability() > best_pose->probability())
+      {
+        best_pose = &pose;
+      }
+    }
+    if (best_pose != nullptr)
+    {
+      state.has_pose = true;
+      state.pose_x = best_pose->pose().position().x();
+      state.pose_y = best_pose->pose().position().y();
+      state.pose_dir = best_pose->pose().dir().mean();
+      state.pose_probability = best_pose->probability();
+    }
+    if (perception.has_ball_in_self())
+    {
+      state.has_ball = true;
+      state.ball_x = perception.ball_in_self().x();
+      state.ball_y = perception.ball_in_self().y();
+    }
+    if (state.has_pose && state.has_ball)
+    {
+      // Same computation as fieldFromSelf without building intermediate messages
+      float cos_dir = std::cos(state.pose_dir);
+      float sin_dir = std::sin(state.pose_dir);
+      state.has_ball_in_field = true;
+      state.ball_field_x = state.pose_x + cos_dir * state.ball_x - sin_dir * state.ball_y;
+      state.ball_field_y = state.pose_y + sin_dir * state.ball_x + cos_dir * state.ball_y;
+    }
+  }
+  state.role = msg.team_play().role();
+  state.status = msg.team_play().status();
+  state.action = msg.intention().action_planned();
+  return state;
+}
+
+template <typename T>
+static void insertAt(std::vector<T>* column, size_t row, const T& value)
+{
+  column->insert(column->begin() + row, value);
+}
+
+template <typename T>
+static void eraseAt(std::vector<T>* column, size_t row)
+{
+  column->erase(column->begin() + row);
+}
+
+size_t RobotStateTable::size() const
+{
+  return team_ids.size();
+}
+
+size_t RobotStateTable::lowerBound(uint32_t team_id, uint32_t robot_id) const
+{
+  size_t low = 0;
+  size_t high = size();
+  while (low < high)
+  {
+    size_t mid = (low + high) / 2;
+    if (team_ids[mid] < team_id || (team_ids[mid] == team_id && robot_ids[mid] < robot_id))
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+int RobotStateTable::findRow(uint32_t team_id, uint32_t robot_id) const
+{
+  size_t row = lowerBound(team_id, robot_id);
+  if (row < size() && team_ids[row] == team_id && robot_ids[row] == robot_id)
+    return row;
+  return -1;
+}
+
+RobotState RobotStateTable::getState(size_t row) const
+{
+  RobotState state;
+  state.team_id = team_ids[row];
+  state.robot_id = robot_ids[row];
+  state.time_stamp = time_stamps[row];
+  state.utc_time_stamp = utc_time_stamps[row];
+  state.has_pose = has_pose[row];
+  state.pose_x = pose_x[row];
+  state.pose_y = pose_y[row];
+  state.pose_dir = pose_dir[row];
+  state.pose_probability = pose_probability[row];
+  state.has_ball = has_ball[row];
+  state.ball_x = ball_x[row];
+  state.ball_y = ball_y[row];
+  state.has_ball_in_field = has_ball_in_field[row];
+  state.ball_field_x = ball_field_x[row];
+  state.ball_field_y = ball_field_y[row];
+  state.role = roles[row];
+  state.status = statuses[row];
+  state.action = actions[row];
+  return state;
+}
+
+void RobotStateTable::update(const RobotState& state)
+{
+  size_t row = lowerBound(state.team_id, state.robot_id);
+  if (row == size() || team_ids[row] != state.team_id || robot_ids[row] != state.robot_id)
+  {
+    insertAt(&team_ids, row, state.team_id);
+    insertAt(&robot_ids, row, state.robot_id);
+    insertAt(&time_stamps, row, state.time_stamp);
+    insertAt(&utc_time_stamps, row, state.utc_time_stamp);
+    insertAt(&has_pose, row, (uint8_t)state.has_pose);
+    insertAt(&pose_x, row, state.pose_x);
+    insertAt(&pose_y, row, state.pose_y);
+    insertAt(&pose_dir, row, state.pose_dir);
+    insertAt(&pose_probability, row, state.pose_probability);
+    insertAt(&has_ball, row, (uint8_t)state.has_ball);
+    insertAt(&ball_x, row, state.ball_x);
+    insertAt(&ball_y, row, state.ball_y);
+    insertAt(&has_ball_in_field, row, (uint8_t)state.has_ball_in_field);
+    insertAt(&ball_field_x, row, state.ball_field_x);
+    insertAt(&ball_field_y, row, state.ball_field_y);
+    insertAt(&roles, row, state.role);
+    insertAt(&statuses, row, state.status);
+    insertAt(&actions, row, state.action);
+    return;
+  }
+  time_stamps[row] = state.time_stamp;
+  utc_time_stamps[row] = state.utc_time_stamp;
+  has_pose[row] = state.has_pose;
+  pose_x[row] = state.pose_x;
+  pose_y[row] = state.pose_y;
+  pose_dir[row] = state.pose_dir;
+  pose_probability[row] = state.pose_probability;
+  has_ball[row] = state.has_ball;
+  ball_x[row] = state.ball_x;
+  ball_y[row] = state.ball_y;
+  has_ball_in_field[row] = state.has_ball_in_field;
+  ball_field_x[row] = state.ball_field_x;
+  ball_field_y[row] = state.ball_field_y;
+  roles[row] = state.role;
+  statuses[row] = state.status;
+  actions[row] = state.action;
+}
+
+void RobotStateTable::erase(uint32_t team_id, uint32_t robot_id)
+{
+  int row = findRow(team_id, robot_id);
+  if (row < 0)
+    return;
+  eraseAt(&team_ids, row);
+  eraseAt(&robot_ids, row);
+  eraseAt(&time_stamps, row);
+  eraseAt(&utc_time_stamps, row);
+  eraseAt(&has_pose, row);
+  eraseAt(&pose_x, row);
+  eraseAt(&pose_y, row);
+  eraseAt(&pose_dir, row);
+  eraseAt(&pose_probability, row);
+  eraseAt(&has_ball, row);
+  eraseAt(&ball_x, row);
+  eraseAt(&ball_y, row);
+  eraseAt(&has_ball_in_field, row);
+  eraseAt(&ball_field_x, row);
+  eraseAt(&ball_field_y, row);
+  eraseAt(&roles, row);
+  eraseAt(&statuses, row);
+  eraseAt(&actions, row);
+}
+
+void RobotStateTable::clear()
+{
+  *this = RobotStateTable();
+}
+
+int RobotStateTable::findClosestToBall(uint32_t team_id) const
+{
+  // Rows of a team are contiguous
+  size_t begin = lowerBound(team_id, 0);
+  size_t end = begin;
+  while (end < size() && team_ids[end] == team_id)
+  {
+    end++;
+  }
+  int best_row = -1;
+  float best_dist2 = std::numeric_limits<float>::max();
+  for (size_t row = begin; row < end; row++)
+  {
+    float dist2 = ball_x[row] * ball_x[row] + ball_y[row] * ball_y[row];
+    if (has_ball[row] && dist2 < best_dist2)
+    {
+      best_dist2 = dist2;
+      best_row = row;
+    }
+  }
+  return best_row;
+}
+
+}  // namespace hl_communication
@@ -0,0 +1,204 @@
+#include <hl_communication/status_cursor.h>
+
+#include <algorithm>
+
+namespace hl_communication
+{
+/**
+ * Return an iterator to the last entry with a time stamp lower or equal to time_stamp, end() if there is none
+ */
+template <typename T>
+static typename std::map<uint64_t, T>::const_iterator findLast(const std::map<uint64_t, T>& entries,
+                                                               uint64_t time_stamp)
+{
+  auto it = entries.upper_bound(time_stamp);
+  if (it == entries.begin())
+    return entries.end();
+  return std::prev(it);
+}
+
+/**
+ * Move 'it' forward while the next entry has a time stamp lower or equal to time_stamp
+ */
+template <typename T>
+static void moveForward(const std::map<uint64_t, T>& entries, typename std::map<uint64_t, T>::const_iterator* it,
+                        uint64_t time_stamp)
+{
+  auto next = (*it == entries.end()) ? entries.begin() : std::next(*it);
+  while (next != entries.end() && next->first <= time_stamp)
+  {
+    *it = next;
+    next++;
+  }
+}
+
+StatusCursor::StatusCursor(const MessageManager& manager_)
+  : manager(manager_)
+  , use_history_length(false)
+  , history_length(0)
+  , time_stamp(0)
+  , gc_iterator(manager_.main_gc_messages.end())
+  , nb_gc_repeats(0)
+  , nb_evictions(0)
+  , gc_changed(false)
+{
+}
+
+StatusCursor::StatusCursor(const MessageManager& manager_, uint64_t history_length_) : StatusCursor(manager_)
+{
+  use_history_length = true;
+  history_length = history_length_;
+}
+
+void StatusCursor::seek(uint64_t new_time_stamp, bool system_clock)
+{
+  if (system_clock)
+  {
+    new_time_stamp -= manager.getOffset();
+  }
+  update(new_time_stamp, true);
+}
+
+bool StatusCursor::advance(uint64_t new_time_stamp, bool system_clock)
+{
+  if (system_clock)
+  {
+    new_time_stamp -= manager.getOffset();
+  }
+  update(new_time_stamp, new_time_stamp < time_stamp);
+  return changed_robots.size() > 0 || gc_changed;
+}
+
+const MessageManager::Status& StatusCursor::getStatus() const
+{
+  return status;
+}
+
+uint64_t StatusCursor::getTimeStamp() const
+{
+  return time_stamp;
+}
+
+const std::vector<RobotIdentifier>& StatusCursor::getChangedRobots() const
+{
+  return changed_robots;
+}
+
+bool StatusCursor::hasGCChanged() const
+{
+  return gc_changed;
+}
+
+void StatusCursor::update(uint64_t new_time_stamp, bool reset)
+{
+  changed_robots.clear();
+  gc_changed = false;
+  time_stamp = new_time_stamp;
+  uint64_t min_ts = time_stamp - history_length;
+  if (reset)
+  {
+    // All previous entries are considered as changed
+    for (const auto& entry : status.robot_messages)
+    {
+      changed_robots.push_back(entry.first);
+    }
+    status.robot_messages.clear();
+  }
+  // Evictions might have invalidated the iterators, they are then positioned again with a binary search while the
+  // status is kept to report only the entries which changed
+  bool relocate = reset || nb_evictions != manager.nb_evictions;
+  nb_evictions = manager.nb_evictions;
+  if (relocate)
+  {
+    robot_iterators.clear();
+  }
+  for (const auto& robot_entry : manager.messages_by_robot)
+  {
+    const RobotIdentifier& robot_id = robot_entry.first;
+    const MessageManager::TimedRobotMsgCollection& messages = robot_entry.second;
+    auto cursor_it = robot_iterators.find(robot_id);
+    if (cursor_it == robot_iterators.end())
+    {
+      // Robots seen for the first time are positioned with a binary search
+      cursor_it = robot_iterators.insert({ robot_id, findLast(messages, time_stamp) }).first;
+    }
+    else
+    {
+      moveForward(messages, &(cursor_it->second), time_stamp);
+    }
+    RobotMsgIterator msg_it = cursor_it->second;
+    bool in_status = msg_it != messages.end() && (!use_history_length || msg_it->first >= min_ts);
+    auto status_it = status.robot_messages.find(robot_id);
+    if (in_status)
+    {
+      if (status_it == status.robot_messages.end())
+      {
+        status.robot_messages[robot_id] = manager.getRobotMsg(robot_id, msg_it->first, msg_it->second);
+        changed_robots.push_back(robot_id);
+      }
+      else if (status_it->second.utc_time_stamp() != msg_it->first)
+      {
+        status_it->second = manager.getRobotMsg(robot_id, msg_it->first, msg_it->second);
+        changed_robots.push_back(robot_id);
+      }
+    }
+    else if (status_it != status.robot_messages.end())
+    {
+      status.robot_messages.erase(status_it);
+      changed_robots.push_back(robot_id);
+    }
+  }
+  // Robots whose messages have all been evicted are not part of the status anymore
+  for (auto status_it = status.robot_messages.begin(); status_it != status.robot_messages.end();)
+  {
+    if (manager.messages_by_robot.count(status_it->first) > 0)
+    {
+      status_it++;
+      continue;
+    }
+    changed_robots.push_back(status_it->first);
+    status_it = status.robot_messages.erase(status_it);
+  }
+  if (reset)
+  {
+    std::sort(changed_robots.begin(), changed_robots.end());
+    changed_robots.erase(std::unique(changed_robots.begin(), changed_robots.end()), changed_robots.end());
+  }
+  const std::deque<MessageManager::GCRepeat>& gc_repeats = manager.gc_repeats;
+  if (relocate)
+  {
+    gc_iterator = findLast(manager.main_gc_messages, time_stamp);
+    nb_gc_repeats = std::upper_bound(gc_repeats.begin(), gc_repeats.end(), time_stamp,
+                                     [](uint64_t ts, const MessageManager::GCRepeat& repeat) {
+                                       return ts < repeat.utc_time_stamp;
+                                     }) -
+                    gc_repeats.begin();
+  }
+  else
+  {
+    moveForward(manager.main_gc_messages, &gc_iterator, time_stamp);
+  }
+  // Repeats received older than the cursor shift the following ones, moving forward accounts for them as well
+  while (nb_gc_repeats < gc_repeats.size() && gc_repeats[nb_gc_repeats].utc_time_stamp <= time_stamp)
+  {
+    nb_gc_repeats++;
+  }
+  MessageManager::GCEntry gc_entry;
+  bool gc_in_status = manager.getGCEntry(gc_iterator, nb_gc_repeats, &gc_entry) &&
+                      (!use_history_length || gc_entry.utc_time_stamp >= min_ts);
+  if (gc_in_status)
+  {
+    if (!status.gc_message.has_utc_time_stamp() || status.gc_message.utc_time_stamp() != gc_entry.utc_time_stamp)
+    {
+      manager.exportGCMsg(gc_entry, &status.gc_message);
+      gc_changed = true;
+    }
+  }
+  else if (status.gc_message.has_utc_time_stamp())
+  {
+    status.gc_message.Clear();
+    gc_changed = true;
+  }
+}
+
+}  // namespace hl_communication
@@ -127,24 +127,24 @@ void UDPBroadcast::closeWrite()
   }
 }
 
-void UDPBroadcast::broadcastMessage(const char* data, size_t len)
+bool UDPBroadcast::broadcastMessage(const char* data, size_t len)
 {
   if (port_write == -1)
   {
-    return;
+    return false;
   }
   if (write_fd == -1)
   {
     std::cout << "WARNING: UDPBroadcast: closed write socket" << std::endl;
     openWrite();
-    return;
+    return false;
   }
 
   if (broadcast_addr.size() == 0)
   {
     std::cout << "WARNING: UDPBroadcast: no broadcast address" << std::endl;
     retrieveBroadcastAddress();
-    return;
+    return false;
   }
   if (count_send > 20)
   {
@@ -152,6 +152,7 @@ void UDPBroadcast::broadcastMessage(const char* data, size_t len)
   }
 
   // Send message to all broadcast address
+  bool sent = false;
   for (size_t i = 0; i < broadcast_addr.size(); i++)
   {
     struct sockaddr_in addr;
@@ -176,8 +177,13 @@ void UDPBroadcast::broadcastMessage(const char* data, size_t len)
       std::cout << "ERROR: UDPBroadcast: send truncated" << std::endl;
       std::cout << strerror(errno) << std::endl;
     }
+    else
+    {
+      sent = true;
+    }
   }
   count_send++;
+  return sent;
 }
 
 bool UDPBroadcast::checkMessage(char* data, size_t* len, uint64_t* src_address, uint32_t* src_port)
@@ -19,6 +19,37 @@ int getDefaultTeamPort(int team_id)
   return 35000 + team_id;
 }
 
+bool decodeReceivedPacket(const char* data, size_t len, GameMsg* msg)
+{
+  // A serialized GameMsg never starts with the header of a GameController packet
+  if (isGCPacket(data, len))
+  {
+    // GameController packets are decoded in place, reusing the GCMsg of the previous packet
+    if (!msg->has_gc_msg())
+    {
+      msg->Clear();
+    }
+    if (!decodeGCPacket(data, len, msg->mutable_gc_msg()))
+    {
+      return false;
+    }
+    // Fields which are not part of the packet are cleared, the result does not depend on the previous packet
+    msg->clear_identifier();
+    msg->mutable_gc_msg()->clear_time_stamp();
+    msg->mutable_gc_msg()->clear_utc_time_stamp();
+    return true;
+  }
+  // Disabling error message when ParseFromArray fails
+  google::protobuf::LogSilencer silencer;
+  bool success = msg->ParseFromArray(data, len);
+  if (msg->has_gc_msg())
+  {
+    // The GCMsg may be reused by the next GameController packet which would not overwrite unknown fields
+    msg->DiscardUnknownFields();
+  }
+  return success;
+}
+
 UDPMessageManager::UDPMessageManager(int port_read, int port_write)
 {
   packet_sent_no = 0;
@@ -72,26 +103,17 @@ void UDPMessageManager::run()
       std::cout << "Packet are too long !" << std::endl;
       continue;
     }
-    game_msg.Clear();
-    std::string string_data(data, len);
     uint64_t time_stamp = getTimeStamp();
-    GameState game_state;
-    // Disabling error message when ParseFromString fails
-    google::protobuf::LogSilencer silencer;
-    if (game_msg.ParseFromString(string_data))
+    if (!decodeReceivedPacket(data, len, &game_msg))
     {
+      std::cerr << "Invalid format for a packet of size: " << len << std::endl;
+      continue;
     }
-    else if (game_state.updateFromMessage(data))
+    if (isGCPacket(data, len))
     {
-      game_state.exportToGCMsg(game_msg.mutable_gc_msg());
       game_msg.mutable_identifier()->set_packet_no(packet_gc_no);
       packet_gc_no++;
     }
-    else
-    {
-      std::cerr << "Invalid format for a packet of size: " << len << std::endl;
-      continue;
-    }
 
     game_msg.mutable_identifier()->set_src_ip(src_address);
     game_msg.mutable_identifier()->set_src_port(ntohs(src_port));
@@ -0,0 +1,137 @@
+#include <hl_communication/camera_model.h>
+#include <hl_communication/utils.h>
+
+#include <opencv2/calib3d.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace hl_communication;
+
+/**
+ * Camera of a humanoid robot standing on the border of the field, looking toward the opposite goal
+ */
+static CameraMetaInformation buildCamera()
+{
+  CameraMetaInformation camera_information;
+  IntrinsicParameters* intrinsic = camera_information.mutable_camera_parameters();
+  intrinsic->set_focal_x(400);
+  intrinsic->set_focal_y(400);
+  intrinsic->set_center_x(320);
+  intrinsic->set_center_y(240);
+  intrinsic->set_img_width(640);
+  intrinsic->set_img_height(480);
+  for (double coeff : { -0.3, 0.09, 0.0, 0.0, 0.0 })
+  {
+    intrinsic->add_distortion(coeff);
+  }
+  // Axes of the camera expressed in field: x toward right of the image, y toward bottom and z forward
+  double tilt = 30 * M_PI / 180;
+  Eigen::Vector3d forward(std::cos(tilt), 0, -std::sin(tilt));
+  Eigen::Vector3d right(0, -1, 0);
+  Eigen::Vector3d down = forward.cross(right);
+  Eigen::Matrix3d camera_from_field;
+  camera_from_field.row(0) = right;
+  camera_from_field.row(1) = down;
+  camera_from_field.row(2) = forward;
+  Eigen::Vector3d camera_in_field(-4.5, 0, 0.6);
+  Eigen::Affine3d affine = Eigen::Translation3d(-camera_from_field * camera_in_field) * camera_from_field;
+  setProtobufFromAffine(affine, camera_information.mutable_pose());
+  return camera_information;
+}
+
+/**
+ * Call 'project' 'nb_iterations' times and return the average duration by point [ns]
+ */
+template <typename Projector>
+static double measure(size_t nb_points, int nb_iterations, Projector project)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int iteration = 0; iteration < nb_iterations; iteration++)
+  {
+    project();
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (nb_iterations * nb_points);
+}
+
+int main(int argc, char** argv)
+{
+  size_t nb_points = 100000;
+  int nb_iterations = 20;
+  if (argc >= 2)
+  {
+    nb_points = std::stoul(argv[1]);
+  }
+  CameraMetaInformation camera_information = buildCamera();
+  CameraModel model(camera_information);
+
+  std::mt19937 engine(42);
+  std::uniform_real_distribution<float> x_distribution(-4.5, 4.5);
+  std::uniform_real_distribution<float> y_distribution(-3, 3);
+  std::vector<cv::Point3f> points(nb_points);
+  std::vector<float> x(nb_points), y(nb_points), z(nb_points, 0);
+  for (size_t idx = 0; idx < nb_points; idx++)
+  {
+    x[idx] = x_distribution(engine);
+    y[idx] = y_distribution(engine);
+    points[idx] = cv::Point3f(x[idx], y[idx], z[idx]);
+  }
+
+  // Reference: cv::projectPoints on all the points at once
+  cv::Mat camera_matrix, distortion_coeffs, rvec, tvec;
+  cv::Size img_size;
+  intrinsicToCV(camera_information.camera_parameters(), &camera_matrix, &distortion_coeffs, &img_size);
+  pose3DToCV(camera_information.pose(), &rvec, &tvec);
+  std::vector<cv::Point2f> cv_points;
+  double cv_ns = measure(nb_points, nb_iterations, [&]() {
+    cv::projectPoints(points, rvec, tvec, camera_matrix, distortion_coeffs, cv_points);
+  });
+
+  double field_to_img_ns = measure(nb_points, 1, [&]() {
+    cv::Point2f img_pos;
+    for (const cv::Point3f& point : points)
+    {
+      fieldToImg(point, camera_information, &img_pos);
+    }
+  });
+
+  std::vector<cv::Point2f> model_points;
+  std::vector<uint8_t> model_valid;
+  double model_ns =
+      measure(nb_points, nb_iterations, [&]() { model.project(points, &model_points, &model_valid); });
+
+  std::vector<float> img_x(nb_points), img_y(nb_points);
+  std::vector<uint8_t> batch_valid(nb_points);
+  double batch_ns = measure(nb_points, nb_iterations, [&]() {
+    model.project(x.data(), y.data(), z.data(), nb_points, img_x.data(), img_y.data(), batch_valid.data());
+  });
+
+  double max_error = 0;
+  size_t nb_valid = 0;
+  for (size_t idx = 0; idx < nb_points; idx++)
+  {
+    if (batch_valid[idx] != model_valid[idx])
+    {
+      std::cerr << "Validity differs for point " << idx << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!batch_valid[idx])
+      continue;
+    nb_valid++;
+    max_error = std::max(max_error, (double)std::fabs(img_x[idx] - cv_points[idx].x));
+    max_error = std::max(max_error, (double)std::fabs(img_y[idx] - cv_points[idx].y));
+  }
+  std::cout << nb_valid << "/" << nb_points << " points inside the image, max difference with cv::projectPoints: "
+            << max_error << " px" << std::endl;
+  std::cout << "cv::projectPoints (batch, no validity): " << cv_ns << " ns/point" << std::endl;
+  std::cout << "fieldToImg: " << field_to_img_ns << " ns/point" << std::endl;
+  std::cout << "CameraModel::project (vector of points): " << model_ns << " ns/point" << std::endl;
+  std::cout << "CameraModel::project (structure of arrays): " << batch_ns << " ns/point" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,283 @@
+#include <hl_communication/game_controller_utils.h>
+#include <hl_communication/message_log.h>
+#include <hl_communication/udp_message_manager.h>
+
+#include "reference_gc_decoder.h"
+
+#include <google/protobuf/util/message_differencer.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace hl_communication;
+using google::protobuf::util::MessageDifferencer;
+
+/**
+ * Number of calls to operator new since the start of the program
+ */
+static std::atomic<uint64_t> nb_allocations(0);
+
+void* operator new(size_t size)
+{
+  nb_allocations++;
+  void* ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+  free(ptr);
+}
+
+static void usage(const char* program)
+{
+  std::cerr << "Usage: " << program << " [-n nb_iterations] [logs...]" << std::endl
+            << "  Robot packets are extracted from the logs, random robot messages are used if none is provided."
+            << std::endl
+            << "  GameController packets are valid packets with random content, each supported layout is measured."
+            << std::endl
+            << "  The original charsToInt parser is measured as a baseline for the layouts it supports." << std::endl;
+}
+
+/**
+ * Write 'value' in little-endian at 'base' + 'field.offset', fields of size 0 are not part of the packet
+ */
+static void writeField(std::string* packet, size_t base, const GCField& field, int value)
+{
+  for (size_t byte = 0; byte < field.size; byte++)
+  {
+    (*packet)[base + field.offset + byte] = (char)((value >> (8 * byte)) & 0xff);
+  }
+}
+
+/**
+ * Valid GameController packets of the given layout, all the exported fields are filled with random values
+ */
+static std::vector<std::string> buildGCPackets(const GCLayout& layout, size_t nb_packets)
+{
+  std::mt19937 engine(42);
+  std::uniform_int_distribution<int> distribution(0, 100);
+  std::vector<std::string> packets(nb_packets);
+  for (std::string& packet : packets)
+  {
+    packet.assign(layout.packet_size, 0);
+    packet.replace(0, 4, "RGme");
+    writeField(&packet, 0, layout.struct_version, layout.version);
+    for (const GCField* field :
+         { &layout.num_player, &layout.game_type, &layout.game_state, &layout.first_half, &layout.kick_off_team,
+           &layout.sec_game_state, &layout.secondary_team, &layout.secondary_mode, &layout.drop_in_team,
+           &layout.drop_in_time, &layout.estimated_secs, &layout.secondary_secs })
+    {
+      writeField(&packet, 0, *field, distribution(engine));
+    }
+    for (size_t team = 0; team < 2; team++)
+    {
+      size_t team_offset = layout.teams_offset + team * layout.team_size;
+      for (const GCField* field : { &layout.team_number, &layout.team_color, &layout.score })
+      {
+        writeField(&packet, team_offset, *field, distribution(engine));
+      }
+      for (int robot = 0; robot < layout.nb_robots; robot++)
+      {
+        size_t robot_offset = team_offset + layout.robots_offset + robot * layout.robot_size;
+        for (const GCField* field : { &layout.penalty, &layout.secs_till_unpenalised, &layout.yellow_card_count,
+                                      &layout.red_card_count })
+        {
+          writeField(&packet, robot_offset, *field, distribution(engine));
+        }
+      }
+    }
+  }
+  return packets;
+}
+
+/**
+ * Robot packets as sent by the robots: serialized GameMsg without reception time stamp
+ */
+static std::vector<std::string> readRobotPackets(const std::vector<std::string>& logs)
+{
+  std::vector<std::string> packets;
+  for (const std::string& path : logs)
+  {
+    std::vector<GameMsg> messages;
+    GameMsgCollection header;
+    readGameMsgs(path, &messages, &header);
+    for (GameMsg& msg : messages)
+    {
+      if (!msg.has_robot_msg())
+        continue;
+      msg.mutable_robot_msg()->clear_time_stamp();
+      msg.mutable_identifier()->clear_src_ip();
+      msg.mutable_identifier()->clear_src_port();
+      packets.push_back(msg.SerializeAsString());
+    }
+  }
+  return packets;
+}
+
+/**
+ * Random robot packets with an identifier, a few pose candidates and a ball
+ */
+static std::vector<std::string> buildRobotPackets(size_t nb_packets)
+{
+  std::mt19937 engine(42);
+  std::uniform_real_distribution<double> position_distribution(-4.5, 4.5);
+  std::vector<std::string> packets(nb_packets);
+  for (size_t idx = 0; idx < nb_packets; idx++)
+  {
+    GameMsg msg;
+    msg.mutable_identifier()->set_packet_no(idx);
+    RobotMsg* robot_msg = msg.mutable_robot_msg();
+    robot_msg->mutable_robot_id()->set_team_id(1);
+    robot_msg->mutable_robot_id()->set_robot_id(1 + idx % 4);
+    robot_msg->set_utc_time_stamp(1500000000000000 + idx * 100000);
+    Perception* perception = robot_msg->mutable_perception();
+    for (int candidate = 0; candidate < 3; candidate++)
+    {
+      WeightedPose* weighted_pose = perception->add_self_in_field();
+      weighted_pose->set_probability(1.0 / (candidate + 2));
+      PoseDistribution* pose = weighted_pose->mutable_pose();
+      pose->mutable_position()->set_x(position_distribution(engine));
+      pose->mutable_position()->set_y(position_distribution(engine));
+      pose->mutable_dir()->set_mean(position_distribution(engine));
+    }
+    perception->mutable_ball_in_self()->set_x(position_distribution(engine));
+    perception->mutable_ball_in_self()->set_y(position_distribution(engine));
+    packets[idx] = msg.SerializeAsString();
+  }
+  return packets;
+}
+
+/**
+ * Duration and allocations of 'decode', both are averaged by packet
+ */
+class Measure
+{
+public:
+  double ns;
+  double allocations;
+};
+
+/**
+ * Decode all the packets 'nb_iterations' times with 'decode'
+ */
+template <typename Decoder>
+static Measure measure(const std::vector<std::string>& packets, int nb_iterations, Decoder decode)
+{
+  uint64_t start_allocations = nb_allocations;
+  auto start = std::chrono::steady_clock::now();
+  for (int iteration = 0; iteration < nb_iterations; iteration++)
+  {
+    for (const std::string& packet : packets)
+    {
+      decode(packet);
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  double nb_decoded = (double)nb_iterations * packets.size();
+  Measure result;
+  result.ns = elapsed.count() / nb_decoded;
+  result.allocations = (nb_allocations - start_allocations) / nb_decoded;
+  return result;
+}
+
+static void print(const std::string& name, const Measure& result)
+{
+  std::cout << name << ": " << result.ns << " ns/packet, " << result.allocations << " allocations/packet" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  int nb_iterations = 10000;
+  std::vector<std::string> logs;
+  for (int arg_idx = 1; arg_idx < argc; arg_idx++)
+  {
+    std::string arg = argv[arg_idx];
+    if (arg == "-n" && arg_idx + 1 < argc)
+    {
+      nb_iterations = std::stoi(argv[++arg_idx]);
+    }
+    else if (arg == "-h" || arg[0] == '-')
+    {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    else
+    {
+      logs.push_back(arg);
+    }
+  }
+  std::vector<std::string> robot_packets = logs.empty() ? buildRobotPackets(64) : readRobotPackets(logs);
+  if (robot_packets.empty())
+  {
+    std::cerr << "No robot messages found in the logs" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Same message reused for all the packets as in UDPMessageManager
+  GameMsg received_msg;
+  const GCLayout* gc_layouts[] = { getGCLayout(12, 640), getGCLayout(12, 688) };
+  for (const GCLayout* layout : gc_layouts)
+  {
+    std::vector<std::string> gc_packets = buildGCPackets(*layout, 64);
+    GCMsg reference_msg;
+    GCMsg reused_msg;
+    // The charsToInt reference decoder only supports the 640 bytes layout, GameState is used for the other ones
+    bool has_reference = referenceDecodeGCPacket(gc_packets[0].data(), gc_packets[0].size(), &reference_msg);
+    for (const std::string& packet : gc_packets)
+    {
+      GameState game_state;
+      bool expected_decoded = has_reference ? referenceDecodeGCPacket(packet.data(), packet.size(), &reference_msg) :
+                                              game_state.updateFromMessage(packet.data(), packet.size());
+      if (!expected_decoded || !decodeGCPacket(packet.data(), packet.size(), &reused_msg))
+      {
+        std::cerr << "Failed to decode a packet" << std::endl;
+        return EXIT_FAILURE;
+      }
+      if (!has_reference)
+      {
+        game_state.exportToGCMsg(&reference_msg);
+      }
+      if (!MessageDifferencer::Equals(reference_msg, reused_msg))
+      {
+        std::cerr << "Decoders disagree on a packet" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+
+    std::string suffix =
+        " (GameController v" + std::to_string(layout->version) + ", " + std::to_string(layout->packet_size) + " bytes)";
+    if (has_reference)
+    {
+      print("charsToInt reference decoder (baseline)" + suffix,
+            measure(gc_packets, nb_iterations, [&reference_msg](const std::string& packet) {
+              referenceDecodeGCPacket(packet.data(), packet.size(), &reference_msg);
+            }));
+    }
+    print("decodeGCPacket" + suffix, measure(gc_packets, nb_iterations, [&reused_msg](const std::string& packet) {
+            decodeGCPacket(packet.data(), packet.size(), &reused_msg);
+          }));
+    print("decodeReceivedPacket" + suffix,
+          measure(gc_packets, nb_iterations, [&received_msg](const std::string& packet) {
+            decodeReceivedPacket(packet.data(), packet.size(), &received_msg);
+          }));
+  }
+  print("decodeReceivedPacket (robots, " + std::to_string(robot_packets.size()) + " packets)",
+        measure(robot_packets, nb_iterations, [&received_msg](const std::string& packet) {
+          decodeReceivedPacket(packet.data(), packet.size(), &received_msg);
+        }));
+  return EXIT_SUCCESS;
+}
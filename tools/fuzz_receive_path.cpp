@@ -0,0 +1,115 @@
+/**
+ * Fuzz target for the decoding of the packets received by UDPMessageManager.
+ *
+ * Built with clang, it is a libFuzzer target (also usable with AFL++ through afl-clang-fast). With other compilers,
+ * the inputs are read from the files given as arguments or from stdin, which allows fuzzing with afl-g++ and replaying
+ * a corpus.
+ *
+ * The program aborts if a packet crashes a decoder or if the GameController decoders disagree. Version 12 packets of
+ * 640 bytes are also compared with the original charsToInt parser (see reference_gc_decoder.h), which does not share
+ * the layout tables of decodeGCPacket.
+ *
+ * The seed corpus in tools/fuzz_corpus/receive_path contains GameController packets of all the supported layouts
+ * (v12 and v12 with warnings) and robot packets.
+ */
+#include <hl_communication/game_controller_utils.h>
+#include <hl_communication/udp_message_manager.h>
+
+#include "reference_gc_decoder.h"
+
+#include <google/protobuf/util/field_comparator.h>
+#include <google/protobuf/util/message_differencer.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+using namespace hl_communication;
+using google::protobuf::util::DefaultFieldComparator;
+using google::protobuf::util::MessageDifferencer;
+
+static void check(bool condition, const char* description)
+{
+  if (!condition)
+  {
+    std::cerr << "Fuzzing check failed: " << description << std::endl;
+    abort();
+  }
+}
+
+/**
+ * Compare two messages, NaN values parsed from robot packets are considered as equal
+ */
+static bool sameContent(const GameMsg& a, const GameMsg& b)
+{
+  static DefaultFieldComparator comparator;
+  comparator.set_treat_nan_as_equal(true);
+  MessageDifferencer differencer;
+  differencer.set_field_comparator(&comparator);
+  return differencer.Compare(a, b);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* raw_data, size_t size)
+{
+  const char* data = reinterpret_cast<const char*>(raw_data);
+  // Reused between inputs as in UDPMessageManager
+  static GameMsg received_msg;
+  bool received = decodeReceivedPacket(data, size, &received_msg);
+  GameMsg fresh_msg;
+  bool fresh_received = decodeReceivedPacket(data, size, &fresh_msg);
+  check(fresh_received == received && (!received || sameContent(fresh_msg, received_msg)),
+        "decoding depends on the previous packet");
+  if (!isGCPacket(data, size))
+    return 0;
+  GameState game_state;
+  bool state_decoded = game_state.updateFromMessage(data, size);
+  GCMsg decoded_msg;
+  bool decoded = decodeGCPacket(data, size, &decoded_msg);
+  check(decoded == state_decoded, "decodeGCPacket and GameState::updateFromMessage disagree on validity");
+  check(decoded == received, "decodeReceivedPacket and decodeGCPacket disagree on validity");
+  if (decoded)
+  {
+    GCMsg state_msg;
+    game_state.exportToGCMsg(&state_msg);
+    check(MessageDifferencer::Equals(state_msg, decoded_msg), "decodeGCPacket differs from GameState");
+    check(MessageDifferencer::Equals(decoded_msg, received_msg.gc_msg()), "reused GCMsg differs from a fresh one");
+  }
+  GCMsg reference_msg;
+  if (referenceDecodeGCPacket(data, size, &reference_msg))
+  {
+    check(decoded, "decodeGCPacket rejects a packet accepted by the reference decoder");
+    check(MessageDifferencer::Equals(reference_msg, decoded_msg), "decodeGCPacket differs from the reference decoder");
+  }
+  return 0;
+}
+
+#ifndef HL_COMMUNICATION_LIBFUZZER
+static void runFile(std::istream& in)
+{
+  std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(content.data()), content.size());
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    runFile(std::cin);
+    return EXIT_SUCCESS;
+  }
+  for (int arg_idx = 1; arg_idx < argc; arg_idx++)
+  {
+    std::ifstream in(argv[arg_idx], std::ios::binary);
+    if (!in.good())
+    {
+      std::cerr << "Failed to open file '" << argv[arg_idx] << "'" << std::endl;
+      return EXIT_FAILURE;
+    }
+    runFile(in);
+  }
+  return EXIT_SUCCESS;
+}
+#endif
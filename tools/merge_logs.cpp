@@ -0,0 +1,56 @@
+#include <hl_communication/log_merge.h>
+
+#include <cstring>
+#include <iostream>
+
+using namespace hl_communication;
+
+static void usage(const char* program)
+{
+  std::cerr << "Usage: " << program << " [-z] [-w dedup_window_ms] <output> <input1> [<input2> ...]" << std::endl
+            << "  -z: compress the output" << std::endl
+            << "  -w: window used to detect duplicated messages [ms], default is 10000" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  LogMergeSettings settings;
+  int arg_idx = 1;
+  while (arg_idx < argc && argv[arg_idx][0] == '-')
+  {
+    if (strcmp(argv[arg_idx], "-z") == 0)
+    {
+      settings.compressed = true;
+      arg_idx++;
+    }
+    else if (strcmp(argv[arg_idx], "-w") == 0 && arg_idx + 1 < argc)
+    {
+      settings.dedup_window = std::stoull(argv[arg_idx + 1]) * 1000;
+      arg_idx += 2;
+    }
+    else
+    {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (argc - arg_idx < 2)
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  std::string output_path = argv[arg_idx];
+  std::vector<std::string> input_paths(argv + arg_idx + 1, argv + argc);
+  try
+  {
+    LogMergeStatistics statistics = mergeLogs(input_paths, output_path, settings);
+    std::cout << "Read " << statistics.messages_read << " messages, wrote " << statistics.messages_written
+              << " messages, skipped " << statistics.duplicates << " duplicates" << std::endl;
+  }
+  catch (const std::runtime_error& exc)
+  {
+    std::cerr << exc.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
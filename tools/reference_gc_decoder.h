@@ -0,0 +1,57 @@
+#pragma once
+
+#include <hl_communication/game_controller_utils.h>
+
+#include <cstring>
+
+namespace hl_communication
+{
+/**
+ * Reference decoder used by the tools to check decodeGCPacket: the charsToInt-based parser of GameState as it was
+ * before GameController layouts were introduced, with its hard-coded offsets. Only version 12 packets of
+ * getGCPacketSize() bytes are supported.
+ *
+ * Return false without modifying 'msg' if the packet is not supported, 'msg' is filled as GameState::exportToGCMsg
+ * otherwise.
+ */
+inline bool referenceDecodeGCPacket(char const* data, size_t size, GCMsg* msg)
+{
+  const int nb_chars_by_team = 308;
+  const int nb_chars_by_robot = 4;
+  if (size != getGCPacketSize() || strncmp(data, "RGme", 4) != 0 || charsToInt(data, 4, 6) != 12)
+    return false;
+  msg->Clear();
+  msg->set_struct_version(charsToInt(data, 4, 6));
+  msg->set_game_type(charsToInt(data, 8, 9));
+  msg->set_num_player(charsToInt(data, 7, 8));
+  msg->set_first_half(charsToInt(data, 10, 11));
+  msg->set_kick_off_team(charsToInt(data, 11, 12));
+  msg->set_sec_game_state(charsToInt(data, 12, 13));
+  msg->set_drop_in_team(charsToInt(data, 17, 18));
+  msg->set_drop_in_time(charsToInt(data, 18, 20));
+  msg->set_estimated_secs(charsToInt(data, 20, 22));
+  msg->set_secondary_secs(charsToInt(data, 22, 24));
+  msg->set_secondary_mode(charsToInt(data, 14, 15));
+  for (int team = 0; team < 2; team++)
+  {
+    char const* team_data = data + 24 + nb_chars_by_team * team;
+    GCTeamMsg* team_msg = msg->add_teams();
+    team_msg->set_team_number(charsToInt(team_data, 0, 1));
+    team_msg->set_team_color(charsToInt(team_data, 1, 2));
+    team_msg->set_score(charsToInt(team_data, 2, 3));
+    // The coach is skipped
+    char const* robots_data = team_data + 260 + nb_chars_by_robot;
+    for (int robot = 0; robot < 6; robot++)
+    {
+      int d = nb_chars_by_robot * robot;
+      GCRobotMsg* robot_msg = team_msg->add_robots();
+      robot_msg->set_penalty(charsToInt(robots_data, d + 0, d + 1));
+      robot_msg->set_secs_till_unpenalised(charsToInt(robots_data, d + 1, d + 2));
+      robot_msg->set_yellow_card_count(charsToInt(robots_data, d + 2, d + 3));
+      robot_msg->set_red_card_count(charsToInt(robots_data, d + 3, d + 4));
+    }
+  }
+  return true;
+}
+
+}  // namespace hl_communication
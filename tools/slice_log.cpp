@@ -0,0 +1,91 @@
+#include <hl_communication/log_slice.h>
+
+#include <cstring>
+#include <iostream>
+
+using namespace hl_communication;
+
+static void usage(const char* program)
+{
+  std::cerr << "Usage: " << program << " [options] <input> <output> <start> <end>" << std::endl
+            << "  start and end are UTC times in seconds since epoch, both are included" << std::endl
+            << "Options:" << std::endl
+            << "  -z: compress the output" << std::endl
+            << "  -t team_id: only keep robot messages from this team, can be repeated" << std::endl
+            << "  -r team_id:robot_id: only keep robot messages from this robot, can be repeated" << std::endl
+            << "  -g: drop GameController messages" << std::endl
+            << "  -s: read the input sequentially even if an index exists" << std::endl;
+}
+
+static uint64_t secondsToUTC(const char* str)
+{
+  return (uint64_t)(std::stod(str) * 1000 * 1000);
+}
+
+int main(int argc, char** argv)
+{
+  LogSliceSettings settings;
+  int arg_idx = 1;
+  try
+  {
+    while (arg_idx < argc && argv[arg_idx][0] == '-')
+    {
+      std::string option = argv[arg_idx];
+      bool has_value = arg_idx + 1 < argc;
+      if (option == "-z")
+      {
+        settings.compressed = true;
+      }
+      else if (option == "-g")
+      {
+        settings.keep_gc = false;
+      }
+      else if (option == "-s")
+      {
+        settings.use_index = false;
+      }
+      else if (option == "-t" && has_value)
+      {
+        settings.team_ids.push_back(std::stoul(argv[++arg_idx]));
+      }
+      else if (option == "-r" && has_value)
+      {
+        std::string robot = argv[++arg_idx];
+        size_t separator = robot.find(':');
+        if (separator == std::string::npos)
+          throw std::invalid_argument("invalid robot '" + robot + "'");
+        RobotIdentifier robot_id;
+        robot_id.set_team_id(std::stoul(robot.substr(0, separator)));
+        robot_id.set_robot_id(std::stoul(robot.substr(separator + 1)));
+        settings.robots.push_back(robot_id);
+      }
+      else
+      {
+        throw std::invalid_argument("invalid option '" + option + "'");
+      }
+      arg_idx++;
+    }
+    if (argc - arg_idx != 4)
+      throw std::invalid_argument("invalid number of arguments");
+    settings.start = secondsToUTC(argv[arg_idx + 2]);
+    settings.end = secondsToUTC(argv[arg_idx + 3]);
+  }
+  catch (const std::logic_error& exc)
+  {
+    std::cerr << exc.what() << std::endl;
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  try
+  {
+    LogSliceStatistics statistics = sliceLog(argv[arg_idx], argv[arg_idx + 1], settings);
+    std::cout << "Read " << statistics.messages_read << " messages" << (statistics.used_index ? " using index" : "")
+              << ", wrote " << statistics.messages_written << " messages" << std::endl;
+  }
+  catch (const std::runtime_error& exc)
+  {
+    std::cerr << exc.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}